@@ -0,0 +1,826 @@
+/*
+  ==============================================================================
+
+    Headless benchmark and offline renderer for ErodeAudioProcessor.
+
+    Runs processBlock without an editor across sample rates, block sizes,
+    channel layouts and parameter sets, and reports ns/sample and the
+    realtime factor. Results can be written to CSV and compared against a
+    previous run to catch regressions.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "RealtimeGuard.h"
+#include "../../Source/TraceEvents.h"
+
+#include <iostream>
+#include <map>
+
+namespace
+{
+    struct ParameterSet
+    {
+        juce::String name;
+        float freq, width, amount, cut;
+        bool automate = false;
+    };
+
+    // One combination of the choice parameters under test, e.g. "eco"
+    struct Variant
+    {
+        juce::String name;
+        std::vector<std::pair<juce::String, float>> values; // parameter id and choice index
+    };
+
+    struct BenchResult
+    {
+        double nsPerSample = 0.0;
+        double realtimeFactor = 0.0;
+        double worstBlockUs = 0.0;
+        double p99Load = 0.0; // from the processor's own load meter
+    };
+
+    const juce::Array<ParameterSet> parameterSets {
+        { "default",   1000.0f,  0.5f, 0.5f,    20.0f },
+        { "sine",      1000.0f,  0.0f, 0.5f,    20.0f },
+        { "noise",     1000.0f,  1.0f, 0.5f,    20.0f },
+        { "low-freq",    20.0f,  0.5f, 0.5f,    20.0f },
+        { "high-freq", 20000.0f, 0.5f, 0.5f,    20.0f },
+        { "full-wet",  1000.0f,  0.5f, 1.0f,    20.0f },
+        { "dry",       1000.0f,  0.5f, 0.0f,    20.0f },
+        { "cut-high",  1000.0f,  0.5f, 0.5f, 10000.0f },
+        { "automated", 1000.0f,  0.5f, 0.5f,    20.0f, true },
+    };
+
+    juce::File getFileOption (const juce::ArgumentList& args, const char* option)
+    {
+        return juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption (option));
+    }
+
+    void printUsage()
+    {
+        std::cout << "ErodeBenchmark - headless processBlock benchmark and offline renderer\n\n"
+                     "Usage: ErodeBenchmark [options]\n"
+                     "  --rates=44100,48000,96000,192000  Sample rates to test\n"
+                     "  --blocks=16,64,256,1024,4096      Block sizes to test\n"
+                     "  --channels=1,2                    Channel counts to test\n"
+                     "  --seconds=10                      Seconds of audio per configuration\n"
+                     "  --signal=noise|sine|sweep|impulse Synthetic input (default noise)\n"
+                     "  --input=file.wav                  Use an audio file as input instead\n"
+                     "  --sweep                           Run every parameter set, not just the default\n"
+                     "  --params=default,sine,...         Run the named parameter sets\n"
+                     "  --freq= --width= --amount= --cut= Override the default parameter set\n"
+                     "  --csv=results.csv                 Write results as CSV\n"
+                     "  --baseline=baseline.csv           Compare against a previous --csv run\n"
+                     "  --tolerance=10                    Allowed slowdown against the baseline in percent\n"
+                     "  --render=out.wav                  Render --input through the default parameter set\n"
+                     "  --quality=precise,eco             Quality tiers to test (default precise)\n"
+                     "  --interp=linear,hermite,sinc      Delay interpolators to test (default linear)\n"
+                     "  --spread=off,on                   Spread modes to test (default off)\n"
+                     "  --noise=live,tables               Noise engines to test (default live)\n"
+                     "  --offline                         Process as a non-realtime render (best quality, helper threads)\n"
+                     "  --governor                        Let the load governor lower quality under pressure (off by default)\n"
+                     "  --check-approx                    Verify the Eco approximation error bounds\n"
+                     "  --check-determinism               Render twice from transport start and check both passes match\n"
+                     "  --rt-check=50                     Check processBlock for allocations, locks and system calls\n"
+                     "  --seed=1                          Noise seed, renders with the same seed are bit-identical\n"
+                     "  --trace=trace.json                Write a Chrome/Perfetto trace (builds with ERODE_TRACE=1)\n";
+    }
+
+    juce::Array<int> parseIntList (const juce::String& text, const juce::Array<int>& fallback)
+    {
+        if (text.isEmpty())
+            return fallback;
+
+        juce::Array<int> values;
+        for (auto& token : juce::StringArray::fromTokens (text, ",", {}))
+            if (token.trim().getIntValue() > 0)
+                values.add (token.trim().getIntValue());
+
+        return values.isEmpty() ? fallback : values;
+    }
+
+    void setParameter (ErodeAudioProcessor& processor, const juce::String& id, float value)
+    {
+        if (auto* param = processor.getAPVTS().getParameter (id))
+            param->setValueNotifyingHost (param->convertTo0to1 (value));
+    }
+
+    void applyParameterSet (ErodeAudioProcessor& processor, const ParameterSet& set)
+    {
+        setParameter (processor, "freq", set.freq);
+        setParameter (processor, "width", set.width);
+        setParameter (processor, "amount", set.amount);
+        setParameter (processor, "cut", set.cut);
+    }
+
+    void applyVariant (ErodeAudioProcessor& processor, const Variant& variant)
+    {
+        for (auto& value : variant.values)
+            setParameter (processor, value.first, value.second);
+    }
+
+    // Multiplies the variants by the requested options of one choice parameter, e.g. --quality=precise,eco
+    void addChoiceDimension (std::vector<Variant>& variants, const juce::String& paramId,
+                             const juce::String& requested, const juce::StringArray& choices)
+    {
+        std::vector<Variant> expanded;
+        for (auto& variant : variants)
+        {
+            for (auto& option : juce::StringArray::fromTokens (requested.isEmpty() ? choices[0] : requested, ",", {}))
+            {
+                const int index = choices.indexOf (option.trim(), true);
+                if (index < 0)
+                    continue;
+
+                auto combined = variant;
+                combined.name += (combined.name.isEmpty() ? "" : "/") + choices[index];
+                combined.values.emplace_back (paramId, (float) index);
+                expanded.push_back (combined);
+            }
+        }
+        variants = expanded;
+    }
+
+    // Slow sweeps over every parameter, advanced once per block like host automation
+    void applyAutomation (ErodeAudioProcessor& processor, double seconds)
+    {
+        auto lfo = [seconds] (double rate) { return 0.5f + 0.5f * (float) std::sin (juce::MathConstants<double>::twoPi * rate * seconds); };
+
+        setParameter (processor, "freq", 20.0f * std::pow (1000.0f, lfo (0.13)));
+        setParameter (processor, "width", lfo (0.29));
+        setParameter (processor, "amount", lfo (0.17));
+        setParameter (processor, "cut", 20.0f * std::pow (100.0f, lfo (0.41)));
+    }
+
+    juce::AudioBuffer<float> makeSignal (const juce::String& type, int numChannels, double sampleRate, int numSamples)
+    {
+        juce::AudioBuffer<float> signal (numChannels, numSamples);
+        juce::Random rand (1234);
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            const double t = sample / sampleRate;
+            float value = 0.0f;
+
+            if (type == "sine")
+                value = 0.5f * (float) std::sin (juce::MathConstants<double>::twoPi * 440.0 * t);
+            else if (type == "sweep")
+            {
+                // Exponential chirp from 20 Hz to 20 kHz over the whole buffer
+                const double duration = numSamples / sampleRate;
+                const double k = std::log (1000.0) / duration;
+                value = 0.5f * (float) std::sin (juce::MathConstants<double>::twoPi * 20.0 * (std::exp (k * t) - 1.0) / k);
+            }
+            else if (type == "impulse")
+                value = (sample % (int) sampleRate) == 0 ? 1.0f : 0.0f;
+            else
+                value = rand.nextFloat() - 0.5f;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                signal.setSample (channel, sample, value);
+        }
+        return signal;
+    }
+
+    bool loadFile (const juce::File& file, juce::AudioBuffer<float>& dest, double& sampleRate)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+        if (reader == nullptr)
+            return false;
+
+        dest.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+        reader->read (&dest, 0, (int) reader->lengthInSamples, 0, true, true);
+        sampleRate = reader->sampleRate;
+        return true;
+    }
+
+    bool writeFile (const juce::File& file, const juce::AudioBuffer<float>& source, double sampleRate)
+    {
+        file.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream (file.createOutputStream());
+        if (stream == nullptr)
+            return false;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), sampleRate,
+                                                                              (unsigned int) source.getNumChannels(),
+                                                                              24, {}, 0));
+        if (writer == nullptr)
+            return false;
+
+        stream.release(); // now owned by the writer
+        return writer->writeFromAudioSampleBuffer (source, 0, source.getNumSamples());
+    }
+
+    // Copies the source into the block, wrapping around and mapping channels cyclically
+    void fillBlock (juce::AudioBuffer<float>& block, const juce::AudioBuffer<float>& source, int& readPos)
+    {
+        const int numSamples = block.getNumSamples();
+        const int sourceLength = source.getNumSamples();
+
+        for (int done = 0; done < numSamples;)
+        {
+            const int chunk = juce::jmin (numSamples - done, sourceLength - readPos);
+            for (int channel = 0; channel < block.getNumChannels(); ++channel)
+                block.copyFrom (channel, done, source, channel % source.getNumChannels(), readPos, chunk);
+
+            done += chunk;
+            readPos = (readPos + chunk) % sourceLength;
+        }
+    }
+
+    bool prepareProcessor (ErodeAudioProcessor& processor, int numChannels, double sampleRate, int blockSize, juce::uint32 seed,
+                           bool offline = false, bool governor = false)
+    {
+        // A fixed seed makes runs and renders reproducible, and without the governor
+        // every block runs the settings under test however loaded the machine is
+        processor.setNoiseSeed (seed);
+        processor.setNonRealtime (offline);
+        processor.setLoadGovernorEnabled (governor);
+
+        auto channelSet = juce::AudioChannelSet::canonicalChannelSet (numChannels);
+        if (channelSet.isDisabled())
+            channelSet = juce::AudioChannelSet::discreteChannels (numChannels);
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add (channelSet);
+        layout.outputBuses.add (channelSet);
+        if (! processor.setBusesLayout (layout))
+            return false;
+
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+        return true;
+    }
+
+    BenchResult runBenchmark (ErodeAudioProcessor& processor, const juce::AudioBuffer<float>& source,
+                              const ParameterSet& set, const Variant& variant, double sampleRate, int blockSize, double seconds)
+    {
+        juce::AudioBuffer<float> block (processor.getTotalNumInputChannels(), blockSize);
+        juce::MidiBuffer midi;
+        int readPos = 0;
+
+        // Warm up caches and let the smoothers settle before measuring
+        applyParameterSet (processor, set);
+        applyVariant (processor, variant);
+        processor.waitForNoiseTables();
+        for (juce::int64 warmup = 0; warmup < (juce::int64) (0.25 * sampleRate); warmup += blockSize)
+        {
+            fillBlock (block, source, readPos);
+            processor.processBlock (block, midi);
+        }
+
+        const auto totalSamples = (juce::int64) (seconds * sampleRate);
+        const auto loadBefore = processor.getLoadMeter().getSnapshot();
+        juce::int64 processed = 0;
+        juce::int64 totalTicks = 0;
+        juce::int64 worstTicks = 0;
+
+        while (processed < totalSamples)
+        {
+            fillBlock (block, source, readPos);
+            if (set.automate)
+                applyAutomation (processor, processed / sampleRate);
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock (block, midi);
+            const auto elapsed = juce::Time::getHighResolutionTicks() - start;
+
+            totalTicks += elapsed;
+            worstTicks = juce::jmax (worstTicks, elapsed);
+            processed += blockSize;
+        }
+
+        const double elapsedSeconds = juce::Time::highResolutionTicksToSeconds (totalTicks);
+
+        BenchResult result;
+        result.nsPerSample = elapsedSeconds * 1.0e9 / (double) processed;
+        result.realtimeFactor = elapsedSeconds > 0.0 ? ((double) processed / sampleRate) / elapsedSeconds : 0.0;
+        result.worstBlockUs = juce::Time::highResolutionTicksToSeconds (worstTicks) * 1.0e6;
+        result.p99Load = LoadMeter::getStatistics (loadBefore, processor.getLoadMeter().getSnapshot()).p99Load;
+        return result;
+    }
+
+    juce::String makeKey (const juce::String& params, const juce::String& variant, int sampleRate, int blockSize, int numChannels)
+    {
+        return params + "/" + variant + "/" + juce::String (sampleRate) + "/" + juce::String (blockSize) + "/" + juce::String (numChannels);
+    }
+
+    // Reads the ns/sample column of a previous --csv run, keyed by configuration
+    std::map<juce::String, double> loadBaseline (const juce::File& file)
+    {
+        std::map<juce::String, double> baseline;
+        juce::StringArray lines;
+        file.readLines (lines);
+
+        for (int i = 1; i < lines.size(); ++i)
+        {
+            auto fields = juce::StringArray::fromTokens (lines[i], ",", {});
+            if (fields.size() >= 6)
+                baseline[makeKey (fields[0], fields[1], fields[2].getIntValue(), fields[3].getIntValue(), fields[4].getIntValue())] = fields[5].getDoubleValue();
+        }
+        return baseline;
+    }
+
+    // Measures the Eco tier approximations against libm and fails if any exceeds its documented bound
+    int checkApproximations()
+    {
+        double tanhError = 0.0;
+        for (float x = -50.0f; x <= 50.0f; x += 1.0e-4f)
+            tanhError = juce::jmax (tanhError, std::abs (FastMath::tanh (x) - std::tanh ((double) x)));
+
+        double powError = 0.0;
+        for (double exponent = -6.0; exponent <= 4.0; exponent += 1.0e-3)
+        {
+            const auto x = (float) std::pow (10.0, exponent);
+            for (float y = -4.0f; y <= 4.0f; y += 0.01f)
+            {
+                const double reference = std::pow ((double) x, (double) y);
+                powError = juce::jmax (powError, std::abs (FastMath::pow (x, y) - reference) / reference);
+            }
+        }
+
+        // Width 0 renders the pure sine, Precise is libm std::sin
+        double sineError = 0.0;
+        for (auto freq : { 20.0f, 440.0f, 5000.0f, 20000.0f })
+        {
+            for (auto blockSize : { 1, 61, 512, 4096 })
+            {
+                Modulator precise, eco;
+                precise.prepare (48000.0, blockSize, 1);
+                eco.prepare (48000.0, blockSize, 1);
+
+                for (int block = 0; block < 96000 / blockSize; ++block)
+                {
+                    const float* expected = precise.render (blockSize, freq, 0.0f, Quality::precise);
+                    const float* actual = eco.render (blockSize, freq, 0.0f, Quality::eco);
+                    for (int i = 0; i < blockSize; ++i)
+                        sineError = juce::jmax (sineError, (double) std::abs (actual[i] - expected[i]));
+                }
+            }
+        }
+
+        int failures = 0;
+        auto report = [&failures] (const char* name, double error, double bound) {
+            const bool passed = error <= bound;
+            failures += passed ? 0 : 1;
+            std::cout << juce::String::formatted ("%-6s max error %.3g (bound %.3g) %s\n", name, error, bound, passed ? "PASS" : "FAIL");
+            };
+        report ("tanh", tanhError, FastMath::tanhMaxError);
+        report ("pow", powError, FastMath::powMaxRelativeError);
+        report ("sine", sineError, FastMath::sineMaxError);
+        return failures > 0 ? 1 : 0;
+    }
+
+    // Moves the transport now and then so the restart-on-play path is covered
+    struct TogglingPlayHead : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setIsPlaying (playing);
+            return info;
+        }
+
+        bool playing = false;
+    };
+
+    // Stands in for the host's audio thread: random block sizes, noise input,
+    // automation and transport changes, with each processBlock call guarded
+    class AudioThreadSimulator : public juce::Thread
+    {
+    public:
+        AudioThreadSimulator (ErodeAudioProcessor& processorToUse, int maxBlockSizeToUse, int numBlocksToRun, juce::int64 seed)
+            : juce::Thread ("rt-check audio"),
+              processor (processorToUse),
+              maxBlockSize (maxBlockSizeToUse),
+              numBlocks (numBlocksToRun),
+              random (seed),
+              buffer (processorToUse.getTotalNumInputChannels(), 2 * maxBlockSizeToUse)
+        {
+            processor.setPlayHead (&playHead);
+        }
+
+        ~AudioThreadSimulator() override
+        {
+            stopThread (1000);
+            processor.setPlayHead (nullptr);
+        }
+
+        void run() override
+        {
+            juce::MidiBuffer midi;
+            const auto& parameters = processor.getParameters();
+
+            for (int block = 0; block < numBlocks && ! threadShouldExit(); ++block)
+            {
+                // Mostly within the announced size, sometimes beyond it like some hosts do
+                const int blockSize = random.nextInt (16) == 0 ? 1 + random.nextInt (2 * maxBlockSize)
+                                                               : 1 + random.nextInt (maxBlockSize);
+                buffer.setSize (buffer.getNumChannels(), blockSize, false, false, true);
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                    for (int i = 0; i < blockSize; ++i)
+                        buffer.setSample (channel, i, random.nextFloat() - 0.5f);
+
+                // Parameter delivery is the host's side and locks inside JUCE, so it stays outside the guard
+                if (random.nextInt (4) == 0)
+                    parameters[random.nextInt (parameters.size())]->setValueNotifyingHost (random.nextFloat());
+                if (random.nextInt (32) == 0)
+                    playHead.playing = ! playHead.playing;
+
+                // Switches the noise engine often enough to cover requesting the tables and dropping them again
+                if (random.nextInt (64) == 0)
+                    setParameter (processor, "noise", processor.getAPVTS().getRawParameterValue ("noise")->load() > 0.5f ? 0.0f : 1.0f);
+
+                {
+                    const RealtimeGuard::ScopedAudioThread guard;
+                    processor.processBlock (buffer, midi);
+                }
+            }
+        }
+
+    private:
+        ErodeAudioProcessor& processor;
+        const int maxBlockSize, numBlocks;
+        juce::Random random;
+        juce::AudioBuffer<float> buffer;
+        TogglingPlayHead playHead;
+    };
+
+    // Runs random configurations on a simulated audio thread while this thread, as the
+    // message thread, restores saved states and attaches, drains and detaches the
+    // analysis tap. Fails on the first configuration with any realtime violation.
+    int checkRealtimeSafety (int numConfigurations, juce::uint32 seed)
+    {
+        RealtimeGuard::install();
+        if (! RealtimeGuard::selfTest())
+        {
+            std::cerr << "rt-check: the guard missed a test allocation or lock, its hooks are not active in this build\n";
+            return 1;
+        }
+
+        juce::Random random ((juce::int64) seed);
+        const int sampleRates[] { 22050, 44100, 48000, 88200, 96000, 192000 };
+        const int channelCounts[] { 1, 2, 6, 12, 16 };
+
+        // Sessions with random parameter values to restore while audio runs
+        std::vector<juce::MemoryBlock> states (8);
+        {
+            ErodeAudioProcessor source;
+            for (auto& state : states)
+            {
+                for (auto* param : source.getParameters())
+                    param->setValueNotifyingHost (random.nextFloat());
+                source.getStateInformation (state);
+            }
+        }
+
+        ErodeAudioProcessor processor;
+        std::vector<float> tapDry (4096), tapWet (4096);
+        juce::int64 totalBlocks = 0;
+
+        for (int configuration = 1; configuration <= numConfigurations; ++configuration)
+        {
+            const int sampleRate = sampleRates[random.nextInt (juce::numElementsInArray (sampleRates))];
+            const int maxBlockSize = 1 + random.nextInt (4096);
+            const int numChannels = channelCounts[random.nextInt (juce::numElementsInArray (channelCounts))];
+
+            // Like a host: stop, release, change the layout and rate, prepare again. The
+            // governor stays on as it would be live.
+            processor.releaseResources();
+            if (! prepareProcessor (processor, numChannels, sampleRate, maxBlockSize, seed + (juce::uint32) configuration, false, true))
+            {
+                std::cerr << "rt-check: could not set up " << numChannels << " channels\n";
+                return 1;
+            }
+
+            const int numBlocks = juce::jlimit (32, 2000, (int) (0.25 * sampleRate / maxBlockSize) + 32);
+            AudioThreadSimulator audio (processor, maxBlockSize, numBlocks, random.nextInt64());
+            audio.startThread (juce::Thread::Priority::highest);
+
+            AnalysisTap* tap = nullptr;
+            while (audio.isThreadRunning())
+            {
+                switch (random.nextInt (4))
+                {
+                    case 0:
+                    {
+                        const auto& state = states[(size_t) random.nextInt ((int) states.size())];
+                        processor.setStateInformation (state.getData(), (int) state.getSize());
+                        break;
+                    }
+
+                    case 1:
+                        if (tap == nullptr)
+                            tap = &processor.attachAnalysisTap();
+                        else
+                        {
+                            processor.detachAnalysisTap();
+                            tap = nullptr;
+                        }
+                        break;
+
+                    default:
+                        if (tap != nullptr)
+                            while (tap->pull (tapDry.data(), tapWet.data(), (int) tapDry.size()) > 0) {}
+                        break;
+                }
+                juce::Thread::sleep (1);
+            }
+
+            if (tap != nullptr)
+                processor.detachAnalysisTap();
+            totalBlocks += numBlocks;
+
+            if (RealtimeGuard::getTotalCount() > 0)
+            {
+                std::cout << juce::String::formatted ("rt-check: FAIL in configuration %d (%d Hz, block %d, %d ch)\n",
+                                                      configuration, sampleRate, maxBlockSize, numChannels);
+                for (int i = 0; i < (int) RealtimeGuard::Violation::numViolations; ++i)
+                {
+                    const auto violation = (RealtimeGuard::Violation) i;
+                    if (RealtimeGuard::getCount (violation) > 0)
+                        std::cout << "  " << RealtimeGuard::getName (violation) << ": " << RealtimeGuard::getCount (violation) << "\n";
+                }
+                std::cout.flush();
+                RealtimeGuard::printFirstViolation();
+                return 1;
+            }
+        }
+
+        std::cout << "rt-check: " << numConfigurations << " configurations, " << totalBlocks
+                  << " blocks, no allocations, locks, sleeps or I/O on the audio thread. PASS\n";
+        if (! RealtimeGuard::canDetectLocksAndSystemCalls())
+            std::cout << "  Only allocations can be checked on this platform\n";
+        return 0;
+    }
+
+    int renderFile (const juce::ArgumentList& args, const ParameterSet& set, const Variant& variant, int blockSize, juce::uint32 seed)
+    {
+        if (! args.containsOption ("--input"))
+        {
+            std::cerr << "--render needs an --input file\n";
+            return 1;
+        }
+
+        juce::AudioBuffer<float> audio;
+        double sampleRate = 0.0;
+        const auto inputFile = getFileOption (args, "--input");
+        if (! loadFile (inputFile, audio, sampleRate))
+        {
+            std::cerr << "Could not read " << inputFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        ErodeAudioProcessor processor;
+        if (! prepareProcessor (processor, audio.getNumChannels(), sampleRate, blockSize, seed,
+                                args.containsOption ("--offline"), args.containsOption ("--governor")))
+        {
+            std::cerr << "Unsupported channel count: " << audio.getNumChannels() << "\n";
+            return 1;
+        }
+        applyParameterSet (processor, set);
+        applyVariant (processor, variant);
+        processor.waitForNoiseTables();
+
+        juce::MidiBuffer midi;
+        for (int start = 0; start < audio.getNumSamples(); start += blockSize)
+        {
+            const int length = juce::jmin (blockSize, audio.getNumSamples() - start);
+            juce::AudioBuffer<float> block (audio.getArrayOfWritePointers(), audio.getNumChannels(), start, length);
+            processor.processBlock (block, midi);
+        }
+        processor.releaseResources();
+
+        const auto outputFile = getFileOption (args, "--render");
+        if (! writeFile (outputFile, audio, sampleRate))
+        {
+            std::cerr << "Could not write " << outputFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        std::cout << "Rendered " << inputFile.getFileName() << " to " << outputFile.getFullPathName() << "\n";
+        return 0;
+    }
+
+    // Renders the same input twice through one instance, with other audio through it
+    // and the transport stopped in between, and fails unless both passes from
+    // transport start match bit for bit
+    int checkDeterminism (const ParameterSet& set, const std::vector<Variant>& variants, const juce::Array<int>& channelCounts,
+                          int sampleRate, int blockSize, juce::uint32 seed)
+    {
+        int failures = 0;
+        for (auto& variant : variants)
+        {
+            for (auto numChannels : channelCounts)
+            {
+                ErodeAudioProcessor processor;
+                if (! prepareProcessor (processor, numChannels, sampleRate, blockSize, seed))
+                {
+                    std::cout << "Skipping unsupported channel count " << numChannels << "\n";
+                    continue;
+                }
+                applyParameterSet (processor, set);
+                applyVariant (processor, variant);
+                processor.waitForNoiseTables();
+
+                TogglingPlayHead playHead;
+                processor.setPlayHead (&playHead);
+                auto render = [&] (juce::AudioBuffer<float> audio, bool playing)
+                {
+                    playHead.playing = playing;
+                    juce::MidiBuffer midi;
+                    for (int start = 0; start < audio.getNumSamples(); start += blockSize)
+                    {
+                        const int length = juce::jmin (blockSize, audio.getNumSamples() - start);
+                        juce::AudioBuffer<float> block (audio.getArrayOfWritePointers(), audio.getNumChannels(), start, length);
+                        processor.processBlock (block, midi);
+                    }
+                    return audio;
+                };
+
+                const auto input = makeSignal ("noise", numChannels, sampleRate, sampleRate);
+                const auto first = render (input, true);
+                render (makeSignal ("sweep", numChannels, sampleRate, sampleRate / 2), false);
+                const auto second = render (input, true);
+                processor.setPlayHead (nullptr);
+                processor.releaseResources();
+
+                bool identical = true;
+                for (int channel = 0; channel < numChannels; ++channel)
+                    identical = identical && std::memcmp (first.getReadPointer (channel), second.getReadPointer (channel),
+                                                          sizeof (float) * (size_t) first.getNumSamples()) == 0;
+
+                std::cout << juce::String::formatted ("determinism: %-16s %3d ch  %s\n", variant.name.toRawUTF8(), numChannels,
+                                                      identical ? "PASS" : "FAIL");
+                if (! identical)
+                    ++failures;
+            }
+        }
+        return failures > 0 ? 1 : 0;
+    }
+}
+
+//==============================================================================
+static int runCommand (const juce::ArgumentList& args)
+{
+    if (args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    if (args.containsOption ("--check-approx"))
+        return checkApproximations();
+
+    const auto sampleRates = parseIntList (args.getValueForOption ("--rates"), { 44100, 48000, 96000, 192000 });
+    const auto blockSizes = parseIntList (args.getValueForOption ("--blocks"), { 16, 64, 256, 1024, 4096 });
+    const auto channelCounts = parseIntList (args.getValueForOption ("--channels"), { 1, 2 });
+    const double seconds = args.containsOption ("--seconds") ? args.getValueForOption ("--seconds").getDoubleValue() : 10.0;
+    const auto signalType = args.containsOption ("--signal") ? args.getValueForOption ("--signal") : juce::String ("noise");
+
+    auto sets = parameterSets;
+    auto overrideValue = [&args] (const char* option, float& value) {
+        if (args.containsOption (option))
+            value = args.getValueForOption (option).getFloatValue();
+        };
+    overrideValue ("--freq", sets.getReference (0).freq);
+    overrideValue ("--width", sets.getReference (0).width);
+    overrideValue ("--amount", sets.getReference (0).amount);
+    overrideValue ("--cut", sets.getReference (0).cut);
+
+    const auto seed = args.containsOption ("--seed") ? (juce::uint32) args.getValueForOption ("--seed").getLargeIntValue() : 1u;
+
+    if (args.containsOption ("--rt-check"))
+        return checkRealtimeSafety (args.getValueForOption ("--rt-check").isEmpty() ? 50 : args.getValueForOption ("--rt-check").getIntValue(), seed);
+
+    std::vector<Variant> variants { Variant() };
+    addChoiceDimension (variants, "quality", args.getValueForOption ("--quality"), { "precise", "eco" });
+    addChoiceDimension (variants, "interp", args.getValueForOption ("--interp"), { "linear", "hermite", "sinc" });
+    addChoiceDimension (variants, "spread", args.getValueForOption ("--spread"), { "off", "on" });
+    addChoiceDimension (variants, "noise", args.getValueForOption ("--noise"), { "live", "tables" });
+
+    if (args.containsOption ("--render"))
+        return renderFile (args, sets[0], variants.front(), blockSizes[0], seed);
+
+    if (args.containsOption ("--check-determinism"))
+        return checkDeterminism (sets[0], variants, channelCounts, sampleRates[0], blockSizes[0], seed);
+
+    juce::StringArray wantedSets { "default" };
+    if (args.containsOption ("--sweep"))
+        wantedSets.clear();
+    else if (args.containsOption ("--params"))
+        wantedSets = juce::StringArray::fromTokens (args.getValueForOption ("--params"), ",", {});
+
+    juce::AudioBuffer<float> fileInput;
+    double fileSampleRate = 0.0;
+    if (args.containsOption ("--input") && ! loadFile (getFileOption (args, "--input"), fileInput, fileSampleRate))
+    {
+        std::cerr << "Could not read " << args.getValueForOption ("--input") << "\n";
+        return 1;
+    }
+
+    std::map<juce::String, double> baseline;
+    if (args.containsOption ("--baseline"))
+        baseline = loadBaseline (getFileOption (args, "--baseline"));
+    const double tolerance = args.containsOption ("--tolerance") ? args.getValueForOption ("--tolerance").getDoubleValue() : 10.0;
+    const bool offline = args.containsOption ("--offline");
+    const bool governor = args.containsOption ("--governor");
+
+    juce::String csv ("params,variant,rate,block,channels,ns_per_sample,realtime_factor,worst_block_us,p99_load_percent\n");
+    int regressions = 0;
+
+    std::cout << juce::String::formatted ("%-10s %-16s %7s %6s %3s %12s %12s %14s %10s\n",
+                                          "params", "variant", "rate", "block", "ch", "ns/sample", "realtime x", "worst blk us", "p99 load");
+
+    for (auto& set : sets)
+    {
+        if (! wantedSets.isEmpty() && ! wantedSets.contains (set.name))
+            continue;
+
+        for (auto& variant : variants)
+        {
+            for (auto numChannels : channelCounts)
+            {
+                for (auto sampleRate : sampleRates)
+                {
+                    // File input is used as-is at every rate; only the timing matters here
+                    auto source = fileInput.getNumSamples() > 0 ? fileInput
+                                                                : makeSignal (signalType, numChannels, sampleRate, sampleRate * 4);
+
+                    for (auto blockSize : blockSizes)
+                    {
+                        ErodeAudioProcessor processor;
+                        if (! prepareProcessor (processor, numChannels, sampleRate, blockSize, seed, offline, governor))
+                        {
+                            std::cout << "Skipping unsupported channel count " << numChannels << "\n";
+                            break;
+                        }
+
+                        const auto result = runBenchmark (processor, source, set, variant, sampleRate, blockSize, seconds);
+                        processor.releaseResources();
+
+                        juce::String verdict;
+                        auto previous = baseline.find (makeKey (set.name, variant.name, sampleRate, blockSize, numChannels));
+                        if (previous != baseline.end() && result.nsPerSample > previous->second * (1.0 + tolerance / 100.0))
+                        {
+                            verdict = juce::String::formatted ("  REGRESSION (baseline %.2f)", previous->second);
+                            ++regressions;
+                        }
+
+                        std::cout << juce::String::formatted ("%-10s %-16s %7d %6d %3d %12.2f %12.1f %14.1f %9.2f%%",
+                                                              set.name.toRawUTF8(), variant.name.toRawUTF8(), sampleRate, blockSize, numChannels,
+                                                              result.nsPerSample, result.realtimeFactor, result.worstBlockUs, result.p99Load * 100.0)
+                                  << verdict << "\n";
+
+                        csv << set.name << "," << variant.name << "," << sampleRate << "," << blockSize << "," << numChannels << ","
+                            << juce::String (result.nsPerSample, 3) << "," << juce::String (result.realtimeFactor, 2) << ","
+                            << juce::String (result.worstBlockUs, 2) << "," << juce::String (result.p99Load * 100.0, 3) << "\n";
+                    }
+                }
+            }
+        }
+    }
+
+    if (args.containsOption ("--csv"))
+        getFileOption (args, "--csv").replaceWithText (csv);
+
+    if (regressions > 0)
+    {
+        std::cout << regressions << " configuration(s) slower than the baseline by more than " << tolerance << "%\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI libraryInitialiser;
+    juce::ArgumentList args (argc, argv);
+    const int result = runCommand (args);
+
+    // Written after any mode, so it covers whatever ran
+    if (args.containsOption ("--trace"))
+    {
+       #if ERODE_TRACE
+        const auto traceFile = getFileOption (args, "--trace");
+        if (! TraceEvents::writeToFile (traceFile))
+        {
+            std::cerr << "Could not write " << traceFile.getFullPathName() << "\n";
+            return 1;
+        }
+        std::cout << "Wrote trace to " << traceFile.getFullPathName() << "\n";
+       #else
+        std::cerr << "--trace needs a build with ERODE_TRACE=1\n";
+        return 1;
+       #endif
+    }
+    return result;
+}
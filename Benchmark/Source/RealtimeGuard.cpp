@@ -0,0 +1,392 @@
+// The hooks replace libc functions that fortified headers define inline
+#undef _FORTIFY_SOURCE
+
+#include "RealtimeGuard.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#if JUCE_LINUX && defined (__GLIBC__)
+ #define ERODE_INTERPOSE_LIBC 1
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <time.h>
+ #include <unistd.h>
+#else
+ #define ERODE_INTERPOSE_LIBC 0
+#endif
+
+#if JUCE_WINDOWS
+ #include <malloc.h>
+#endif
+
+namespace
+{
+    using RealtimeGuard::Violation;
+
+    // Plain thread_locals, so checking them never allocates
+    thread_local bool onAudioThread = false;
+    thread_local bool reporting = false;
+
+    std::atomic<int> counts[(size_t) Violation::numViolations] {};
+    std::atomic<bool> haveFirst { false };
+    Violation firstViolation = Violation::allocation;
+
+   #if ERODE_INTERPOSE_LIBC
+    constexpr int maxStackDepth = 48;
+    void* firstStack[maxStackDepth];
+    int firstStackDepth = 0;
+   #endif
+
+    // Called from inside the hooks, so it must not allocate, lock or recurse
+    void report (Violation violation) noexcept
+    {
+        if (! onAudioThread || reporting)
+            return;
+
+        reporting = true;
+        counts[(size_t) violation].fetch_add (1);
+
+        bool expected = false;
+        if (haveFirst.compare_exchange_strong (expected, true))
+        {
+            firstViolation = violation;
+           #if ERODE_INTERPOSE_LIBC
+            firstStackDepth = backtrace (firstStack, maxStackDepth);
+           #endif
+        }
+        reporting = false;
+    }
+}
+
+//==============================================================================
+#if ERODE_INTERPOSE_LIBC
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void __libc_free (void*);
+}
+
+namespace
+{
+    void* rawAlloc (size_t size) noexcept                         { return __libc_malloc (size); }
+    void* rawAlignedAlloc (size_t size, size_t alignment) noexcept { return __libc_memalign (alignment, size); }
+    void rawFree (void* ptr) noexcept                             { __libc_free (ptr); }
+    void rawAlignedFree (void* ptr) noexcept                      { __libc_free (ptr); }
+
+    // The next definition of a libc function, looked up once
+    template <typename Function>
+    Function getReal (std::atomic<Function>& cache, const char* name) noexcept
+    {
+        auto function = cache.load (std::memory_order_relaxed);
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<Function> (dlsym (RTLD_NEXT, name));
+            cache.store (function, std::memory_order_relaxed);
+        }
+        return function;
+    }
+
+    std::atomic<int (*) (pthread_mutex_t*)> realMutexLock { nullptr };
+    std::atomic<int (*) (pthread_rwlock_t*)> realReadLock { nullptr };
+    std::atomic<int (*) (pthread_rwlock_t*)> realWriteLock { nullptr };
+    std::atomic<int (*)()> realYield { nullptr };
+    std::atomic<int (*) (const timespec*, timespec*)> realNanosleep { nullptr };
+    std::atomic<int (*) (clockid_t, int, const timespec*, timespec*)> realClockNanosleep { nullptr };
+    std::atomic<int (*) (useconds_t)> realUsleep { nullptr };
+    std::atomic<ssize_t (*) (int, void*, size_t)> realRead { nullptr };
+    std::atomic<ssize_t (*) (int, const void*, size_t)> realWrite { nullptr };
+    std::atomic<int (*) (const char*, int, ...)> realOpen { nullptr };
+    std::atomic<int (*) (int)> realClose { nullptr };
+}
+
+extern "C"
+{
+    void* malloc (size_t size) noexcept                  { report (Violation::allocation); return __libc_malloc (size); }
+    void* calloc (size_t count, size_t size) noexcept    { report (Violation::allocation); return __libc_calloc (count, size); }
+    void* realloc (void* ptr, size_t size) noexcept      { report (Violation::allocation); return __libc_realloc (ptr, size); }
+    void* memalign (size_t alignment, size_t size) noexcept { report (Violation::allocation); return __libc_memalign (alignment, size); }
+    void* aligned_alloc (size_t alignment, size_t size) noexcept { report (Violation::allocation); return __libc_memalign (alignment, size); }
+
+    int posix_memalign (void** result, size_t alignment, size_t size) noexcept
+    {
+        report (Violation::allocation);
+        *result = __libc_memalign (alignment, size);
+        return *result != nullptr ? 0 : ENOMEM;
+    }
+
+    void free (void* ptr) noexcept
+    {
+        if (ptr != nullptr)
+            report (Violation::deallocation);
+        __libc_free (ptr);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept
+    {
+        report (Violation::lock);
+        return getReal (realMutexLock, "pthread_mutex_lock") (mutex);
+    }
+
+    int pthread_rwlock_rdlock (pthread_rwlock_t* lock) noexcept
+    {
+        report (Violation::lock);
+        return getReal (realReadLock, "pthread_rwlock_rdlock") (lock);
+    }
+
+    int pthread_rwlock_wrlock (pthread_rwlock_t* lock) noexcept
+    {
+        report (Violation::lock);
+        return getReal (realWriteLock, "pthread_rwlock_wrlock") (lock);
+    }
+
+    int sched_yield() noexcept
+    {
+        report (Violation::yield);
+        return getReal (realYield, "sched_yield")();
+    }
+
+    int nanosleep (const timespec* duration, timespec* remaining)
+    {
+        report (Violation::sleep);
+        return getReal (realNanosleep, "nanosleep") (duration, remaining);
+    }
+
+    int clock_nanosleep (clockid_t clock, int flags, const timespec* duration, timespec* remaining)
+    {
+        report (Violation::sleep);
+        return getReal (realClockNanosleep, "clock_nanosleep") (clock, flags, duration, remaining);
+    }
+
+    int usleep (useconds_t microseconds)
+    {
+        report (Violation::sleep);
+        return getReal (realUsleep, "usleep") (microseconds);
+    }
+
+    ssize_t read (int fd, void* buffer, size_t size)
+    {
+        report (Violation::io);
+        return getReal (realRead, "read") (fd, buffer, size);
+    }
+
+    ssize_t write (int fd, const void* buffer, size_t size)
+    {
+        report (Violation::io);
+        return getReal (realWrite, "write") (fd, buffer, size);
+    }
+
+    int open (const char* path, int flags, ...)
+    {
+        report (Violation::io);
+
+        // The mode is only passed when a file may be created
+        mode_t mode = 0;
+        if ((flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE)
+        {
+            va_list args;
+            va_start (args, flags);
+            mode = (mode_t) va_arg (args, int);
+            va_end (args);
+        }
+        return getReal (realOpen, "open") (path, flags, mode);
+    }
+
+    int close (int fd)
+    {
+        report (Violation::io);
+        return getReal (realClose, "close") (fd);
+    }
+}
+#else
+namespace
+{
+    void* rawAlloc (size_t size) noexcept { return std::malloc (size); }
+    void rawFree (void* ptr) noexcept     { std::free (ptr); }
+
+   #if JUCE_WINDOWS
+    void* rawAlignedAlloc (size_t size, size_t alignment) noexcept { return _aligned_malloc (size, alignment); }
+    void rawAlignedFree (void* ptr) noexcept                      { _aligned_free (ptr); }
+   #else
+    void* rawAlignedAlloc (size_t size, size_t alignment) noexcept
+    {
+        void* ptr = nullptr;
+        return posix_memalign (&ptr, juce::jmax (alignment, sizeof (void*)), size) == 0 ? ptr : nullptr;
+    }
+    void rawAlignedFree (void* ptr) noexcept { std::free (ptr); }
+   #endif
+}
+#endif
+
+//==============================================================================
+// Replacement global allocation functions. With glibc they skip the malloc hook,
+// so each allocation is counted once.
+namespace
+{
+    void* allocate (size_t size) noexcept
+    {
+        report (Violation::allocation);
+        return rawAlloc (size > 0 ? size : 1);
+    }
+
+    void* allocateAligned (size_t size, std::align_val_t alignment) noexcept
+    {
+        report (Violation::allocation);
+        return rawAlignedAlloc (size > 0 ? size : 1, static_cast<size_t> (alignment));
+    }
+
+    void release (void* ptr) noexcept
+    {
+        if (ptr == nullptr)
+            return;
+        report (Violation::deallocation);
+        rawFree (ptr);
+    }
+
+    void releaseAligned (void* ptr) noexcept
+    {
+        if (ptr == nullptr)
+            return;
+        report (Violation::deallocation);
+        rawAlignedFree (ptr);
+    }
+
+    void* allocateOrThrow (void* ptr)
+    {
+        if (ptr == nullptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+}
+
+void* operator new (size_t size)                                                      { return allocateOrThrow (allocate (size)); }
+void* operator new[] (size_t size)                                                    { return allocateOrThrow (allocate (size)); }
+void* operator new (size_t size, const std::nothrow_t&) noexcept                      { return allocate (size); }
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept                    { return allocate (size); }
+void* operator new (size_t size, std::align_val_t alignment)                          { return allocateOrThrow (allocateAligned (size, alignment)); }
+void* operator new[] (size_t size, std::align_val_t alignment)                        { return allocateOrThrow (allocateAligned (size, alignment)); }
+void* operator new (size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept   { return allocateAligned (size, alignment); }
+void* operator new[] (size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateAligned (size, alignment); }
+
+void operator delete (void* ptr) noexcept                                             { release (ptr); }
+void operator delete[] (void* ptr) noexcept                                           { release (ptr); }
+void operator delete (void* ptr, size_t) noexcept                                     { release (ptr); }
+void operator delete[] (void* ptr, size_t) noexcept                                   { release (ptr); }
+void operator delete (void* ptr, const std::nothrow_t&) noexcept                      { release (ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept                    { release (ptr); }
+void operator delete (void* ptr, std::align_val_t) noexcept                           { releaseAligned (ptr); }
+void operator delete[] (void* ptr, std::align_val_t) noexcept                         { releaseAligned (ptr); }
+void operator delete (void* ptr, size_t, std::align_val_t) noexcept                   { releaseAligned (ptr); }
+void operator delete[] (void* ptr, size_t, std::align_val_t) noexcept                 { releaseAligned (ptr); }
+void operator delete (void* ptr, std::align_val_t, const std::nothrow_t&) noexcept    { releaseAligned (ptr); }
+void operator delete[] (void* ptr, std::align_val_t, const std::nothrow_t&) noexcept  { releaseAligned (ptr); }
+
+//==============================================================================
+namespace RealtimeGuard
+{
+    const char* getName (Violation violation)
+    {
+        switch (violation)
+        {
+            case Violation::allocation:   return "allocation";
+            case Violation::deallocation: return "deallocation";
+            case Violation::lock:         return "lock";
+            case Violation::yield:        return "yield";
+            case Violation::sleep:        return "sleep";
+            case Violation::io:           return "I/O";
+            case Violation::numViolations:
+            default:                      break;
+        }
+        return "unknown";
+    }
+
+    ScopedAudioThread::ScopedAudioThread()  { onAudioThread = true; }
+    ScopedAudioThread::~ScopedAudioThread() { onAudioThread = false; }
+
+    void install()
+    {
+       #if ERODE_INTERPOSE_LIBC
+        getReal (realMutexLock, "pthread_mutex_lock");
+        getReal (realReadLock, "pthread_rwlock_rdlock");
+        getReal (realWriteLock, "pthread_rwlock_wrlock");
+        getReal (realYield, "sched_yield");
+        getReal (realNanosleep, "nanosleep");
+        getReal (realClockNanosleep, "clock_nanosleep");
+        getReal (realUsleep, "usleep");
+        getReal (realRead, "read");
+        getReal (realWrite, "write");
+        getReal (realOpen, "open");
+        getReal (realClose, "close");
+
+        // The first backtrace() loads the unwinder, which allocates
+        void* warmUp[4];
+        backtrace (warmUp, 4);
+       #endif
+    }
+
+    bool canDetectLocksAndSystemCalls()
+    {
+        return ERODE_INTERPOSE_LIBC != 0;
+    }
+
+    bool selfTest()
+    {
+        reset();
+        {
+            const ScopedAudioThread scope;
+
+            // Called directly, so the compiler can't elide the pair
+            static void* volatile sink = nullptr;
+            sink = ::operator new (16);
+            ::operator delete (sink);
+
+            juce::CriticalSection mutex;
+            const juce::ScopedLock lock (mutex);
+        }
+
+        const bool caught = getCount (Violation::allocation) > 0
+                         && (! canDetectLocksAndSystemCalls() || getCount (Violation::lock) > 0);
+        reset();
+        return caught;
+    }
+
+    int getCount (Violation violation)
+    {
+        return counts[(size_t) violation].load();
+    }
+
+    int getTotalCount()
+    {
+        int total = 0;
+        for (auto& count : counts)
+            total += count.load();
+        return total;
+    }
+
+    void reset()
+    {
+        for (auto& count : counts)
+            count = 0;
+        haveFirst = false;
+    }
+
+    void printFirstViolation()
+    {
+        if (! haveFirst.load())
+            return;
+
+        std::cerr << "First violation: " << getName (firstViolation) << "\n";
+       #if ERODE_INTERPOSE_LIBC
+        backtrace_symbols_fd (firstStack, firstStackDepth, STDERR_FILENO);
+       #endif
+    }
+}
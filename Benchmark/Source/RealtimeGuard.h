@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    Catches realtime-unsafe calls made from a thread while it is marked as the
+    audio thread: heap allocation and release, mutex locks, yields, sleeps and
+    file I/O.
+
+    Allocations are caught everywhere through replacement operator new/delete.
+    On Linux with glibc malloc/free, pthread mutexes, sleeps and read/write are
+    interposed as well, so calls from C code and inside JUCE are seen too.
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+namespace RealtimeGuard
+{
+    enum class Violation { allocation, deallocation, lock, yield, sleep, io, numViolations };
+
+    const char* getName (Violation violation);
+
+    // Marks the calling thread as the audio thread until the scope ends
+    struct ScopedAudioThread
+    {
+        ScopedAudioThread();
+        ~ScopedAudioThread();
+    };
+
+    // Resolves the interposed functions up front, call once before checking
+    void install();
+
+    // False where only allocations can be seen
+    bool canDetectLocksAndSystemCalls();
+
+    // Provokes an allocation and a lock inside a scope, false if the guard missed them
+    bool selfTest();
+
+    int getCount (Violation violation);
+    int getTotalCount();
+    void reset();
+
+    // Writes the call stack of the first violation since reset() to stderr, where supported
+    void printFirstViolation();
+}
@@ -0,0 +1,37 @@
+#include "AnalysisTap.h"
+
+AnalysisTap::AnalysisTap(int capacity) :
+    fifo(capacity),
+    storage(2, capacity)
+{
+    storage.clear();
+}
+
+void AnalysisTap::push(const float* dry, const float* wet, int numSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    juce::FloatVectorOperations::copy(storage.getWritePointer(0, start1), dry, size1);
+    juce::FloatVectorOperations::copy(storage.getWritePointer(1, start1), wet, size1);
+    if (size2 > 0) {
+        juce::FloatVectorOperations::copy(storage.getWritePointer(0, start2), dry + size1, size2);
+        juce::FloatVectorOperations::copy(storage.getWritePointer(1, start2), wet + size1, size2);
+    }
+    fifo.finishedWrite(size1 + size2);
+}
+
+int AnalysisTap::pull(float* dry, float* wet, int maxSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(maxSamples, start1, size1, start2, size2);
+
+    juce::FloatVectorOperations::copy(dry, storage.getReadPointer(0, start1), size1);
+    juce::FloatVectorOperations::copy(wet, storage.getReadPointer(1, start1), size1);
+    if (size2 > 0) {
+        juce::FloatVectorOperations::copy(dry + size1, storage.getReadPointer(0, start2), size2);
+        juce::FloatVectorOperations::copy(wet + size1, storage.getReadPointer(1, start2), size2);
+    }
+    fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
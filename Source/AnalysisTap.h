@@ -0,0 +1,22 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Single-producer/single-consumer FIFO carrying the dry and wet mono sums from
+// the audio thread to the spectrum display. The audio thread writes whole
+// blocks with vector copies; the reader drains complete runs of samples into
+// its own history, so it never sees a half-written frame.
+class AnalysisTap
+{
+public:
+    explicit AnalysisTap(int capacity = 32768);
+
+    // Audio thread. Samples that don't fit while the reader is behind are dropped.
+    void push(const float* dry, const float* wet, int numSamples) noexcept;
+
+    // Reader thread. Copies up to maxSamples and returns how many were copied.
+    int pull(float* dry, float* wet, int maxSamples) noexcept;
+
+private:
+    juce::AbstractFifo fifo;
+    juce::AudioBuffer<float> storage;
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <JuceHeader.h>
+
+// One SIMD register's worth of channels
+using Lanes = juce::dsp::SIMDRegister<float>;
+
+// Interleaved sample frames for processing channels in SIMD lanes. Channel c lives
+// in lane c % lanes of group c / lanes; each frame holds every group for one sample,
+// zero-padded to whole groups, so per-sample work is one vector op per group
+// however wide the bus is.
+class ChannelFrames
+{
+public:
+    static constexpr int lanes = static_cast<int>(Lanes::size());
+
+    // Groups sharing a 64-byte cache line. Buses wider than this get their frames
+    // padded to whole lines, so threads working on different lines of groups never
+    // write to the same one.
+    static constexpr int cacheLineBytes = 64;
+    static constexpr int groupsPerCacheLine = cacheLineBytes / static_cast<int>(sizeof(float) * lanes);
+
+    static int getNumGroupsFor(int numChannels) { return juce::jmax(1, (numChannels + lanes - 1) / lanes); }
+
+    void prepare(int numChannelsToUse, int maxFrames)
+    {
+        numChannels = numChannelsToUse;
+        numGroups = getNumGroupsFor(numChannels);
+        const int paddedGroups = numGroups > groupsPerCacheLine
+                                   ? (numGroups + groupsPerCacheLine - 1) / groupsPerCacheLine * groupsPerCacheLine
+                                   : numGroups;
+        stride = paddedGroups * lanes;
+        storage.assign(static_cast<size_t>(stride * juce::jmax(maxFrames, 1)) + cacheLineBytes / sizeof(float), 0.0f);
+        data = juce::snapPointerToAlignment(storage.data(), cacheLineBytes);
+    }
+
+    void clear() { std::fill(storage.begin(), storage.end(), 0.0f); }
+
+    int getNumChannels() const { return numChannels; }
+    int getNumGroups() const { return numGroups; }
+
+    // Copies planar samples in; padding lanes keep their zeros. By default every
+    // channel is copied, numChannelsToCopy limits it to the first few.
+    void load(const juce::AudioBuffer<float>& source, int sourceStart, int numFrames, int numChannelsToCopy = -1) noexcept
+    {
+        const int count = numChannelsToCopy < 0 ? numChannels : juce::jmin(numChannelsToCopy, numChannels);
+        for (int channel = 0; channel < count; ++channel) {
+            const float* src = source.getReadPointer(channel, sourceStart);
+            float* dest = data + channel;
+            for (int i = 0; i < numFrames; ++i)
+                dest[i * stride] = src[i];
+        }
+    }
+
+    void store(juce::AudioBuffer<float>& dest, int destStart, int numFrames, int numChannelsToCopy = -1) const noexcept
+    {
+        const int count = numChannelsToCopy < 0 ? numChannels : juce::jmin(numChannelsToCopy, numChannels);
+        for (int channel = 0; channel < count; ++channel) {
+            const float* src = data + channel;
+            float* out = dest.getWritePointer(channel, destStart);
+            for (int i = 0; i < numFrames; ++i)
+                out[i] = src[i * stride];
+        }
+    }
+
+    float getSample(int frame, int channel) const noexcept
+    {
+        return data[frame * stride + channel];
+    }
+
+    Lanes get(int frame, int group) const noexcept
+    {
+        return Lanes::fromRawArray(data + frame * stride + group * lanes);
+    }
+
+    void set(int frame, int group, Lanes value) noexcept
+    {
+        value.copyToRawArray(data + frame * stride + group * lanes);
+    }
+
+private:
+    std::vector<float> storage;
+    float* data = nullptr;
+    int numChannels = 0;
+    int numGroups = 1;
+    int stride = lanes;
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <JuceHeader.h>
+#include "ChannelFrames.h"
+
+// Output high-pass for the "Cut" control. Second-order TPT state variable filter
+// with Q = 0.5, matching IIR::Coefficients::makeHighPass(sampleRate, cut, 0.5).
+// The prewarped gain tan(pi * f / fs) comes from a shared table, so the cutoff
+// can change every sample without trig or allocation on the audio thread.
+// State is kept per channel group so all lanes of a group filter at once, and
+// coefficients are passed in, so separate groups can be filtered on separate threads.
+class CutFilter
+{
+public:
+    struct Coefficients
+    {
+        float g = 0.0f;
+        float h = 1.0f;
+    };
+
+    void prepare(double sampleRate, int numChannels)
+    {
+        getGainTable(); // build the shared table off the audio thread
+        normScale = static_cast<float>(tableSize / (maxNormalisedCutoff * sampleRate));
+        state.assign(static_cast<size_t>(ChannelFrames::getNumGroupsFor(numChannels)), State {});
+    }
+
+    void reset()
+    {
+        std::fill(state.begin(), state.end(), State {});
+    }
+
+    // Cheap enough to call once per sample
+    Coefficients getCoefficients(float hz) const noexcept
+    {
+        const auto& table = getGainTable();
+        float pos = juce::jlimit(0.0f, static_cast<float>(tableSize) - 0.001f, hz * normScale);
+        int index = static_cast<int>(pos);
+        float fraction = pos - static_cast<float>(index);
+        Coefficients c;
+        c.g = table[index] + fraction * (table[index + 1] - table[index]);
+        c.h = 1.0f / ((1.0f + c.g) * (1.0f + c.g)); // 1 / (1 + k*g + g^2) with k = 1/Q = 2
+        return c;
+    }
+
+    Lanes process(int group, Lanes x, Coefficients c) noexcept
+    {
+        Lanes& z1 = state[static_cast<size_t>(group)].s1;
+        Lanes& z2 = state[static_cast<size_t>(group)].s2;
+
+        Lanes hp = (x - z1 * (2.0f + c.g) - z2) * c.h;
+        Lanes bp = hp * c.g + z1;
+        Lanes lp = bp * c.g + z2;
+        z1 = hp * c.g + bp;
+        z2 = bp * c.g + lp;
+        return hp;
+    }
+
+private:
+    static constexpr int tableSize = 2048;
+    static constexpr double maxNormalisedCutoff = 0.49; // cutoffs are clamped just below Nyquist
+
+    using GainTable = std::array<float, tableSize + 1>;
+
+    static const GainTable& getGainTable()
+    {
+        static const GainTable table = [] {
+            GainTable t {};
+            for (int i = 0; i <= tableSize; ++i)
+                t[static_cast<size_t>(i)] = static_cast<float>(std::tan(juce::MathConstants<double>::pi * maxNormalisedCutoff * i / tableSize));
+            return t;
+        }();
+        return table;
+    }
+
+    // A cache line per group, so threads filtering neighbouring groups don't share one
+    struct alignas(ChannelFrames::cacheLineBytes) State
+    {
+        Lanes s1 = Lanes::expand(0.0f);
+        Lanes s2 = Lanes::expand(0.0f);
+    };
+
+    std::vector<State> state;
+    float normScale = 0.0f;
+};
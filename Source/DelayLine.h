@@ -0,0 +1,189 @@
+#pragma once
+#include <JuceHeader.h>
+#include "ChannelFrames.h"
+
+// Fractional delay read quality, cheapest first
+enum class Interpolation { linear, hermite, sinc };
+
+// Multichannel ring buffer for the modulated delay, stored as interleaved frames
+// so every channel group is read with vector ops. The length is a power of two
+// so wrapping is a mask rather than a compare or modulo, and reads take
+// fractional delays in samples.
+class DelayLine
+{
+public:
+    void prepare(int numChannels, int maxDelaySamples)
+    {
+        getSincTable(); // build the shared table off the audio thread
+
+        // Room behind the longest delay for the oldest interpolation taps
+        size = juce::nextPowerOfTwo(juce::jmax(maxDelaySamples + sincTaps, 2));
+        mask = size - 1;
+        ring.prepare(juce::jmax(numChannels, 1), size);
+        reset();
+    }
+
+    void reset()
+    {
+        ring.clear();
+        writePosition = 0;
+    }
+
+    int getSize() const { return size; }
+
+    // Shortest delay each interpolator can read without touching unwritten samples
+    static constexpr float getMinimumDelay(Interpolation interpolation)
+    {
+        return interpolation == Interpolation::sinc ? static_cast<float>(sincTaps / 2)
+             : interpolation == Interpolation::hermite ? 2.0f
+             : 1.0f;
+    }
+
+    // Reads delaySamples behind the write for frame of the current chunk, for one
+    // channel group. Call before push() for that frame; groups are independent, so
+    // each can run through the whole chunk on its own before advance().
+    template <Interpolation interpolation>
+    Lanes read(int group, float delaySamples, int frame) const noexcept
+    {
+        return interpolate<interpolation>(delaySamples, frame, [this, group](int index) { return ring.get(index, group); });
+    }
+
+    // Sinc taps per read, and the position and blended coefficients for one delay.
+    // These depend only on the delay, so when every group reads the same delay in a
+    // frame the kernel is built once for the frame rather than once per group.
+    static constexpr int sincTaps = 8;
+
+    struct SincKernel
+    {
+        int whole;
+        std::array<float, sincTaps> coefficients;
+    };
+
+    static SincKernel getSincKernel(float delaySamples) noexcept
+    {
+        SincKernel kernel;
+        kernel.whole = static_cast<int>(delaySamples);
+        const float t = delaySamples - static_cast<float>(kernel.whole);
+
+        // Blend the two nearest phases of the shared table
+        const auto& table = getSincTable();
+        const float phasePos = t * sincPhases;
+        const int phase = juce::jmin(static_cast<int>(phasePos), sincPhases - 1);
+        const float phaseFraction = phasePos - static_cast<float>(phase);
+        const auto& c0 = table[static_cast<size_t>(phase)];
+        const auto& c1 = table[static_cast<size_t>(phase + 1)];
+        for (size_t k = 0; k < static_cast<size_t>(sincTaps); ++k)
+            kernel.coefficients[k] = c0[k] + phaseFraction * (c1[k] - c0[k]);
+        return kernel;
+    }
+
+    // Sinc read of one channel group with a kernel from getSincKernel()
+    Lanes read(int group, const SincKernel& kernel, int frame) const noexcept
+    {
+        return applySinc(kernel, frame, [this, group](int index) { return ring.get(index, group); });
+    }
+
+    // Same, with its own delay per lane (Spread). Each lane is a separate gather,
+    // so this costs about one scalar read per channel.
+    template <Interpolation interpolation>
+    Lanes read(int group, Lanes delaySamples, int frame) const noexcept
+    {
+        Lanes result = Lanes::expand(0.0f);
+        for (int lane = 0; lane < ChannelFrames::lanes; ++lane) {
+            const int channel = group * ChannelFrames::lanes + lane;
+            result.set(static_cast<size_t>(lane), interpolate<interpolation>(delaySamples.get(static_cast<size_t>(lane)), frame,
+                [this, channel](int index) { return ring.getSample(index, channel); }));
+        }
+        return result;
+    }
+
+    void push(int group, Lanes x, int frame) noexcept
+    {
+        ring.set((writePosition + frame) & mask, group, x);
+    }
+
+    // Moves every channel on by numSamples, once all groups have been pushed
+    void advance(int numSamples) noexcept
+    {
+        writePosition = (writePosition + numSamples) & mask;
+    }
+
+private:
+    // fetch(index) returns the stored frame or sample at a ring index; the same
+    // arithmetic serves whole lane groups and single channels
+    template <Interpolation interpolation, typename Fetch>
+    auto interpolate(float delaySamples, int frame, Fetch&& fetch) const noexcept
+    {
+        const int position = writePosition + frame;
+        const int whole = static_cast<int>(delaySamples);
+        const float t = delaySamples - static_cast<float>(whole);
+        const int index0 = (position - whole) & mask;
+
+        if constexpr (interpolation == Interpolation::linear) {
+            const auto x0 = fetch(index0);
+            const auto x1 = fetch((index0 - 1) & mask);
+            return x0 + (x1 - x0) * t;
+        }
+        else if constexpr (interpolation == Interpolation::hermite) {
+            // 4-point, 3rd-order Hermite (Catmull-Rom) between the two middle samples
+            const auto xm1 = fetch((index0 + 1) & mask);
+            const auto x0 = fetch(index0);
+            const auto x1 = fetch((index0 - 1) & mask);
+            const auto x2 = fetch((index0 - 2) & mask);
+
+            const auto c1 = (x1 - xm1) * 0.5f;
+            const auto c2 = xm1 - x0 * 2.5f + x1 * 2.0f - x2 * 0.5f;
+            const auto c3 = (x2 - xm1) * 0.5f + (x0 - x1) * 1.5f;
+            return ((c3 * t + c2) * t + c1) * t + x0;
+        }
+        else {
+            return applySinc(getSincKernel(delaySamples), frame, fetch);
+        }
+    }
+
+    // Windowed sinc over sincTaps frames, oldest tap first
+    template <typename Fetch>
+    auto applySinc(const SincKernel& kernel, int frame, Fetch&& fetch) const noexcept -> std::decay_t<decltype(fetch(0))>
+    {
+        const int oldest = writePosition + frame - kernel.whole - sincTaps / 2;
+        auto sum = fetch(oldest & mask) * kernel.coefficients[0];
+        for (int k = 1; k < sincTaps; ++k)
+            sum += fetch((oldest + k) & mask) * kernel.coefficients[static_cast<size_t>(k)];
+        return sum;
+    }
+
+    static constexpr int sincPhases = 256;
+
+    using SincTable = std::array<std::array<float, sincTaps>, sincPhases + 1>;
+
+    // Blackman-windowed sinc per fractional phase, each phase normalised to unity gain at DC
+    static const SincTable& getSincTable()
+    {
+        static const SincTable table = [] {
+            SincTable t {};
+            const double pi = juce::MathConstants<double>::pi;
+            const double halfWidth = sincTaps / 2;
+            for (int phase = 0; phase <= sincPhases; ++phase) {
+                const double fraction = static_cast<double>(phase) / sincPhases;
+                double sum = 0.0;
+                for (int k = 0; k < sincTaps; ++k) {
+                    // Distance of tap k from the read position
+                    const double x = k - halfWidth + fraction;
+                    const double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(pi * x) / (pi * x);
+                    const double window = 0.42 + 0.5 * std::cos(pi * x / halfWidth) + 0.08 * std::cos(2.0 * pi * x / halfWidth);
+                    t[static_cast<size_t>(phase)][static_cast<size_t>(k)] = static_cast<float>(sinc * window);
+                    sum += sinc * window;
+                }
+                for (auto& c : t[static_cast<size_t>(phase)])
+                    c = static_cast<float>(c / sum);
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    ChannelFrames ring;
+    int size = 1;
+    int mask = 0;
+    int writePosition = 0;
+};
@@ -1,4 +1,5 @@
 #include "ErodeLookAndFeel.h"
+#include "TraceEvents.h"
 
 ErodeLookAndFeel::ErodeLookAndFeel() {
 	setColour(juce::ResizableWindow::backgroundColourId, juce::Colour(0xff232323)); 
@@ -14,10 +15,11 @@ ErodeLookAndFeel::ErodeLookAndFeel() {
 
 }
 
-// Entirely copied from juce_LookAndFeel_V4.cpp but without thumb
+// Adapted from juce_LookAndFeel_V4.cpp: no thumb, and the background arc comes from a cached image
 void ErodeLookAndFeel::drawRotarySlider (juce::Graphics& g, int x, int y, int width, int height, float sliderPos,
                                        const float rotaryStartAngle, const float rotaryEndAngle, juce::Slider& slider)
 {
+    ERODE_TRACE_SCOPE("drawRotarySlider");
     auto outline = slider.findColour (juce::Slider::rotarySliderOutlineColourId);
     auto fill    = slider.findColour (juce::Slider::rotarySliderFillColourId);
 
@@ -27,23 +29,39 @@ void ErodeLookAndFeel::drawRotarySlider (juce::Graphics& g, int x, int y, int wi
     auto toAngle = rotaryStartAngle + sliderPos * (rotaryEndAngle - rotaryStartAngle);
     auto lineW = radius * 0.3f;
     auto arcRadius = radius - lineW * 0.5f;
+    auto stroke = juce::PathStrokeType (lineW, juce::PathStrokeType::curved, juce::PathStrokeType::rounded);
 
-    juce::Path backgroundArc;
-    backgroundArc.addCentredArc (bounds.getCentreX(),
-                                 bounds.getCentreY(),
-                                 arcRadius,
-                                 arcRadius,
-                                 0.0f,
-                                 rotaryStartAngle,
-                                 rotaryEndAngle,
-                                 true);
+    // Rendered at the physical pixel scale so it stays sharp on high-DPI screens
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (track.image.isNull() || track.width != width || track.height != height || track.scale != scale
+        || track.startAngle != rotaryStartAngle || track.endAngle != rotaryEndAngle || track.colour != outline)
+    {
+        track = { juce::Image (juce::Image::ARGB, juce::jmax (1, juce::roundToInt (width * scale)),
+                               juce::jmax (1, juce::roundToInt (height * scale)), true),
+                  width, height, scale, rotaryStartAngle, rotaryEndAngle, outline };
+
+        const auto local = bounds.translated ((float) -x, (float) -y);
+        juce::Path backgroundArc;
+        backgroundArc.addCentredArc (local.getCentreX(),
+                                     local.getCentreY(),
+                                     arcRadius,
+                                     arcRadius,
+                                     0.0f,
+                                     rotaryStartAngle,
+                                     rotaryEndAngle,
+                                     true);
+
+        juce::Graphics trackGraphics (track.image);
+        trackGraphics.addTransform (juce::AffineTransform::scale (scale));
+        trackGraphics.setColour (outline);
+        trackGraphics.strokePath (backgroundArc, stroke);
+    }
 
-    g.setColour (outline);
-    g.strokePath (backgroundArc, juce::PathStrokeType (lineW, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
+    g.drawImage (track.image, juce::Rectangle<int> (x, y, width, height).toFloat());
 
     if (slider.isEnabled())
     {
-        juce::Path valueArc;
+        valueArc.clear();
         valueArc.addCentredArc (bounds.getCentreX(),
                                 bounds.getCentreY(),
                                 arcRadius,
@@ -54,7 +72,7 @@ void ErodeLookAndFeel::drawRotarySlider (juce::Graphics& g, int x, int y, int wi
                                 true);
 
         g.setColour (fill);
-        g.strokePath (valueArc, juce::PathStrokeType (lineW, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
+        g.strokePath (valueArc, stroke);
     }
 }
 
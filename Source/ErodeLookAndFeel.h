@@ -10,4 +10,17 @@ public:
 		juce::Slider& slider) override;
 
 	juce::Label* createSliderTextBox(juce::Slider& slider) override;
+
+private:
+	// The knobs' background track, stroked once per size and display scale. All
+	// knobs share a size, so one image serves them all.
+	struct TrackImage
+	{
+		juce::Image image;
+		int width = 0, height = 0;
+		float scale = 0.0f, startAngle = 0.0f, endAngle = 0.0f;
+		juce::Colour colour;
+	};
+	TrackImage track;
+	juce::Path valueArc; // reused so value changes don't allocate a new path
 };
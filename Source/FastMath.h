@@ -0,0 +1,64 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Accuracy tiers for the modulator's transcendental math. Precise calls libm
+// everywhere. Eco swaps in the approximations below and a quadrature phasor
+// for the sine; the worst-case errors listed here are checked by
+// ErodeBenchmark --check-approx.
+enum class Quality { precise, eco };
+
+struct FastMath
+{
+    // Absolute error against std::tanh, any finite input
+    static constexpr float tanhMaxError = 1.0e-4f;
+    // Relative error against std::pow, x in [1e-6, 1e4] and y in [-4, 4]
+    static constexpr float powMaxRelativeError = 1.0e-4f;
+    // Absolute error of the Eco sine oscillator against std::sin
+    static constexpr float sineMaxError = 2.0e-6f;
+
+    // [7/6] Pade approximant, clamped where it meets the asymptote
+    static float tanh(float x) noexcept
+    {
+        x = juce::jlimit(-5.0f, 5.0f, x);
+        float x2 = x * x;
+        float num = x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)));
+        float den = 135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f));
+        return juce::jlimit(-1.0f, 1.0f, num / den);
+    }
+
+    // x must be positive and normal
+    static float log2(float x) noexcept
+    {
+        juce::uint32 bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        float exponent = static_cast<float>(static_cast<int>((bits >> 23) & 0xff) - 127);
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+        float mantissa;
+        std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+        // log2(m) = 2/ln2 * atanh((m - 1) / (m + 1)), series truncated after t^7
+        float t = (mantissa - 1.0f) / (mantissa + 1.0f);
+        float t2 = t * t;
+        return exponent + t * (2.8853900f + t2 * (0.9617967f + t2 * (0.5770780f + t2 * 0.4121986f)));
+    }
+
+    static float exp2(float x) noexcept
+    {
+        x = juce::jlimit(-126.0f, 126.0f, x);
+        float whole = std::floor(x);
+        float f = x - whole;
+
+        // Taylor series of e^(f ln2), f in [0, 1)
+        float p = 1.0f + f * (0.69314718f + f * (0.24022651f + f * (0.05550411f + f * (0.00961813f + f * (0.00133336f + f * 0.00015404f)))));
+
+        juce::uint32 bits = static_cast<juce::uint32>(static_cast<int>(whole) + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return p * scale;
+    }
+
+    static float pow(float x, float y) noexcept
+    {
+        return x > 0.0f ? exp2(y * log2(x)) : 0.0f;
+    }
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <JuceHeader.h>
+#include "DelayLine.h"
+#include "FastMath.h"
+
+// Keeps processBlock inside its deadline on an overloaded machine by giving up
+// quality one stage at a time, least audible first: sinc delay reads drop to
+// Hermite, then to linear, the modulator switches to the Eco approximations, then
+// updates its glides less often, and last the spectrum display stops being fed.
+// Stages are cumulative. An overrun, or a smoothed load above budget, drops a
+// stage; a long enough stretch well under budget climbs back one. Stages that
+// would change nothing for the current settings are passed straight through.
+//
+// Audio thread only, apart from getStage().
+class LoadGovernor
+{
+public:
+    enum Stage { full, hermiteReads, linearReads, ecoModulator, coarseControl, noAnalysis, numStages };
+
+    struct Settings
+    {
+        Interpolation interpolation = Interpolation::linear;
+        Quality quality = Quality::precise;
+        bool coarseControl = false;
+        bool feedAnalysis = true;
+
+        bool operator==(const Settings& other) const noexcept
+        {
+            return interpolation == other.interpolation && quality == other.quality
+                && coarseControl == other.coarseControl && feedAnalysis == other.feedAnalysis;
+        }
+        bool operator!=(const Settings& other) const noexcept { return !(*this == other); }
+    };
+
+    // Fractions of the block's deadline. Erode shares the deadline with the rest of
+    // the host's graph, so it backs off well before it overruns on its own.
+    static constexpr double budget = 0.6;
+    static constexpr double stepUpLoad = 0.25;
+
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        setStage(full);
+        smoothedLoad = 0.0;
+        secondsAtStage = 0.0;
+        quietSeconds = 0.0;
+        stepUpDelay = minStepUpDelay;
+        climbed = false;
+    }
+
+    // Once per block before processing it, with the load of the block before
+    void update(double lastLoad, int numSamples, const Settings& requested) noexcept
+    {
+        const double blockSeconds = numSamples / sampleRate;
+        smoothedLoad += (lastLoad - smoothedLoad) * (1.0 - std::exp(-blockSeconds / smoothingSeconds));
+        secondsAtStage += blockSeconds;
+        quietSeconds = smoothedLoad < stepUpLoad ? quietSeconds + blockSeconds : 0.0;
+
+        const bool overloaded = lastLoad >= 1.0 || smoothedLoad > budget;
+        if (overloaded && stage < numStages - 1 && secondsAtStage >= holdSeconds) {
+            // Falling straight back after a climb means it came too soon: wait longer next time
+            if (climbed && secondsAtStage < stepUpDelay)
+                stepUpDelay = juce::jmin(stepUpDelay * 2.0, maxStepUpDelay);
+            step(1, requested);
+            climbed = false;
+        }
+        else if (stage > full && quietSeconds >= stepUpDelay) {
+            step(-1, requested);
+            climbed = true;
+        }
+        else if (stage == full && secondsAtStage >= maxStepUpDelay) {
+            // Settled at full quality again, so the next pressure starts with a short wait
+            stepUpDelay = minStepUpDelay;
+        }
+    }
+
+    // What to run this block instead of the parameters' settings
+    Settings apply(Settings requested) const noexcept
+    {
+        return apply(requested, stage);
+    }
+
+    // Any thread
+    int getStage() const noexcept { return publishedStage.load(std::memory_order_relaxed); }
+
+private:
+    static Settings apply(Settings settings, int stageToApply) noexcept
+    {
+        if (stageToApply >= hermiteReads && settings.interpolation == Interpolation::sinc)
+            settings.interpolation = Interpolation::hermite;
+        if (stageToApply >= linearReads)
+            settings.interpolation = Interpolation::linear;
+        if (stageToApply >= ecoModulator)
+            settings.quality = Quality::eco;
+        if (stageToApply >= coarseControl)
+            settings.coarseControl = true;
+        if (stageToApply >= noAnalysis)
+            settings.feedAnalysis = false;
+        return settings;
+    }
+
+    void step(int direction, const Settings& requested) noexcept
+    {
+        const auto current = apply(requested, stage);
+        int next = stage + direction;
+        while (next > full && next < numStages - 1 && apply(requested, next) == current)
+            next += direction;
+
+        // Climbing, go on through the stages that give the same settings as this one
+        if (direction < 0)
+            while (next > full && apply(requested, next - 1) == apply(requested, next))
+                --next;
+
+        setStage(next);
+        secondsAtStage = 0.0;
+        quietSeconds = 0.0;
+    }
+
+    void setStage(int newStage) noexcept
+    {
+        stage = newStage;
+        publishedStage.store(newStage, std::memory_order_relaxed);
+    }
+
+    static constexpr double smoothingSeconds = 0.05;
+    static constexpr double holdSeconds = 0.1; // lets a step show up in the load before the next
+    static constexpr double minStepUpDelay = 2.0, maxStepUpDelay = 32.0;
+
+    double sampleRate = 44100.0;
+    int stage = full;
+    std::atomic<int> publishedStage { full };
+    double smoothedLoad = 0.0;
+    double secondsAtStage = 0.0;
+    double quietSeconds = 0.0; // how long the smoothed load has been under stepUpLoad
+    double stepUpDelay = minStepUpDelay;
+    bool climbed = false;      // the last step was up
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+// Times every processBlock against its deadline (numSamples / sampleRate) and keeps
+// lock-free totals plus a log-spaced histogram of the load. The audio thread is the
+// only writer and never resets anything; readers take cumulative snapshots and
+// subtract two of them to get the statistics of any window they like, so the
+// editor and a test harness can read at the same time without interfering.
+class LoadMeter
+{
+public:
+    // Load is the fraction of the block's deadline spent processing it
+    struct Statistics
+    {
+        juce::int64 numBlocks = 0;
+        double meanLoad = 0.0;
+        double p99Load = 0.0;
+        double maxLoad = 0.0;
+        double meanBlockMicros = 0.0;
+        double longestBlockMicros = 0.0; // since the meter was created
+    };
+
+    // Loads below minLoad share the first bin, the last bin takes everything past its range
+    static constexpr double minLoad = 1.0e-4;
+    static constexpr int binsPerOctave = 8;
+    static constexpr int numBins = 16 * binsPerOctave + 1; // up to about 6.5x the deadline
+
+    struct Snapshot
+    {
+        std::array<juce::uint32, numBins> bins {};
+        juce::int64 totalTicks = 0;
+        juce::int64 totalLoadPpm = 0; // sum of the loads in parts per million
+        juce::int64 maxTicks = 0; // longest block
+        double maxLoad = 0.0;     // highest load, not necessarily the same block
+    };
+
+    // Not while the audio thread is running, the totals carry over
+    void prepare(double sampleRate)
+    {
+        ticksPerSample = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()) / sampleRate;
+        lastLoad.store(0.0, std::memory_order_relaxed);
+    }
+
+    // Load of the most recent block, for the audio thread to react to
+    double getLastLoad() const noexcept { return lastLoad.load(std::memory_order_relaxed); }
+
+    // Audio thread: wrap processBlock in one of these
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(LoadMeter& meterToUse, int numSamplesInBlock) noexcept
+            : meter(meterToUse), numSamples(numSamplesInBlock), start(juce::Time::getHighResolutionTicks()) {}
+
+        ~ScopedTimer() { meter.addBlock(juce::Time::getHighResolutionTicks() - start, numSamples); }
+
+    private:
+        LoadMeter& meter;
+        const int numSamples;
+        const juce::int64 start;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedTimer)
+    };
+
+    // Any thread
+    Snapshot getSnapshot() const noexcept
+    {
+        Snapshot snapshot;
+        for (size_t i = 0; i < bins.size(); ++i)
+            snapshot.bins[i] = bins[i].load(std::memory_order_relaxed);
+        snapshot.totalTicks = totalTicks.load(std::memory_order_relaxed);
+        snapshot.totalLoadPpm = totalLoadPpm.load(std::memory_order_relaxed);
+        snapshot.maxTicks = maxTicks.load(std::memory_order_relaxed);
+        snapshot.maxLoad = maxLoad.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    // Statistics of the blocks between two snapshots. The window's maximum is exact
+    // when a new all-time peak fell into it, otherwise the top of its highest bin.
+    static Statistics getStatistics(const Snapshot& earlier, const Snapshot& later) noexcept
+    {
+        Statistics stats;
+        std::array<juce::int64, numBins> counts {};
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] = static_cast<juce::int64>(later.bins[i] - earlier.bins[i]);
+            stats.numBlocks += counts[i];
+        }
+        if (stats.numBlocks == 0)
+            return stats;
+
+        const double blocks = static_cast<double>(stats.numBlocks);
+        const double microsPerTick = 1.0e6 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+        stats.meanLoad = static_cast<double>(later.totalLoadPpm - earlier.totalLoadPpm) * 1.0e-6 / blocks;
+        stats.meanBlockMicros = static_cast<double>(later.totalTicks - earlier.totalTicks) * microsPerTick / blocks;
+        stats.longestBlockMicros = static_cast<double>(later.maxTicks) * microsPerTick;
+
+        // Upper edge of the bin holding the 99th percentile block
+        const auto rank = static_cast<juce::int64>(std::ceil(0.99 * blocks));
+        juce::int64 seen = 0;
+        int highest = 0;
+        for (int i = 0; i < numBins; ++i) {
+            if (counts[static_cast<size_t>(i)] == 0)
+                continue;
+            if (seen < rank && seen + counts[static_cast<size_t>(i)] >= rank)
+                stats.p99Load = getBinTop(i);
+            seen += counts[static_cast<size_t>(i)];
+            highest = i;
+        }
+
+        stats.maxLoad = later.maxLoad > earlier.maxLoad ? later.maxLoad : juce::jmin(getBinTop(highest), later.maxLoad);
+        stats.p99Load = juce::jmin(stats.p99Load, stats.maxLoad);
+        return stats;
+    }
+
+private:
+    static double getBinTop(int bin) noexcept
+    {
+        return minLoad * std::exp2(static_cast<double>(bin + 1) / binsPerOctave);
+    }
+
+    void addBlock(juce::int64 ticks, int numSamples) noexcept
+    {
+        if (numSamples <= 0 || ticksPerSample <= 0.0)
+            return;
+
+        const double load = static_cast<double>(ticks) / (ticksPerSample * numSamples);
+        const int bin = load <= minLoad ? 0
+                      : juce::jmin(numBins - 1, static_cast<int>(std::log2(load / minLoad) * binsPerOctave));
+
+        // Single writer, so plain load/store pairs are enough and skip the locked adds
+        auto& count = bins[static_cast<size_t>(bin)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        totalTicks.store(totalTicks.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+        totalLoadPpm.store(totalLoadPpm.load(std::memory_order_relaxed) + static_cast<juce::int64>(load * 1.0e6), std::memory_order_relaxed);
+        if (ticks > maxTicks.load(std::memory_order_relaxed))
+            maxTicks.store(ticks, std::memory_order_relaxed);
+        if (load > maxLoad.load(std::memory_order_relaxed))
+            maxLoad.store(load, std::memory_order_relaxed);
+        lastLoad.store(load, std::memory_order_relaxed);
+    }
+
+    double ticksPerSample = 0.0;
+    std::array<std::atomic<juce::uint32>, numBins> bins {};
+    std::atomic<juce::int64> totalTicks { 0 };
+    std::atomic<juce::int64> totalLoadPpm { 0 };
+    std::atomic<juce::int64> maxTicks { 0 };
+    std::atomic<double> maxLoad { 0.0 };
+    std::atomic<double> lastLoad { 0.0 };
+};
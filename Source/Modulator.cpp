@@ -0,0 +1,364 @@
+#include "Modulator.h"
+#include "TraceEvents.h"
+
+void Modulator::prepare(double newSampleRate, int maximumBlockSize, juce::uint32 seed, int maximumVoices)
+{
+    sampleRate = newSampleRate;
+
+    const int capacity = juce::jmax(maximumBlockSize, 1);
+    const int voices = juce::jmax(maximumVoices, 1);
+    noiseBuffer.setSize(voices, capacity);
+    sineBuffer.setSize(voices, capacity);
+    cosineBuffer.setSize(1, capacity);
+    offsetBuffer.setSize(voices, capacity);
+    fadeBuffer.setSize(voices, capacity);
+    noiseBuffer.clear();
+    sineBuffer.clear();
+    cosineBuffer.clear();
+    offsetBuffer.clear();
+
+    noiseSources.resize(static_cast<size_t>(voices));
+    tableOffsets.resize(static_cast<size_t>(voices));
+    noiseFrames.prepare(voices, capacity);
+    bandS1.assign(static_cast<size_t>(noiseFrames.getNumGroups()), Lanes::expand(0.0f));
+    bandS2.assign(static_cast<size_t>(noiseFrames.getNumGroups()), Lanes::expand(0.0f));
+
+    smoothedFreq.reset(sampleRate, smoothingSeconds);
+    smoothedWidth.reset(sampleRate, smoothingSeconds);
+    smoothersPrimed = false;
+
+    noiseTables = previousTables = nullptr;
+    tablesPlaying = false;
+    engineFadeLength = juce::jmax(1, juce::roundToInt(sampleRate * engineFadeSeconds));
+    engineFadePosition = engineFadeLength;
+
+    reset(seed);
+}
+
+void Modulator::reset(juce::uint32 seed)
+{
+    // Voice 0 keeps the plain seed so a single voice sounds as it always has
+    for (size_t voice = 0; voice < noiseSources.size(); ++voice) {
+        noiseSources[voice].setSeed(seed + static_cast<juce::uint32>(voice) * 0x9e3779b9u);
+        noiseSources[voice].setPosition(0);
+        tableOffsets[voice] = NoiseTables::getStartOffset(seed, static_cast<int>(voice));
+    }
+    std::fill(bandS1.begin(), bandS1.end(), Lanes::expand(0.0f));
+    std::fill(bandS2.begin(), bandS2.end(), Lanes::expand(0.0f));
+    noiseRunning = true;
+    lfoPhase = 0.0;
+    smoothersPrimed = false;
+
+    tablesPlaying = noiseTables != nullptr;
+    previousTables = noiseTables;
+    engineFadePosition = engineFadeLength;
+}
+
+static float power(float x, float y, Quality quality)
+{
+    return quality == Quality::eco ? FastMath::pow(x, y) : std::pow(x, y);
+}
+
+const float* Modulator::render(int numSamples, float freq, float width, Quality quality, int numVoices)
+{
+    ERODE_TRACE_SCOPE("modulator");
+    jassert(numSamples <= getMaxBlockSize());
+    numVoices = juce::jlimit(1, getMaxVoices(), numVoices);
+
+    setTargets(freq, width);
+
+    // While a sweep is in progress the filter, Q and mix follow it once per sub-block,
+    // so a host buffer of any size still moves smoothly. Steady blocks take one pass.
+    const bool ramping = smoothedFreq.isSmoothing() || smoothedWidth.isSmoothing();
+    const int step = ramping ? (coarseControl ? coarseControlInterval : controlInterval) : juce::jmax(numSamples, 1);
+
+    for (int start = 0; start < numSamples; start += step) {
+        const int length = juce::jmin(step, numSamples - start);
+        const float segmentFreq = smoothedFreq.getCurrentValue();
+        const float segmentWidth = smoothedWidth.getCurrentValue();
+        smoothedFreq.skip(length);
+        smoothedWidth.skip(length);
+
+        // Width parked at an end only needs the half that is audible
+        if (segmentWidth <= 0.0f)
+            renderSegment<Kernel::sineOnly>(start, length, segmentFreq, segmentWidth, quality, numVoices);
+        else if (segmentWidth >= 1.0f)
+            renderSegment<Kernel::noiseOnly>(start, length, segmentFreq, segmentWidth, quality, numVoices);
+        else
+            renderSegment<Kernel::mixed>(start, length, segmentFreq, segmentWidth, quality, numVoices);
+    }
+    return offsetBuffer.getReadPointer(0);
+}
+
+void Modulator::advance(int numSamples, float freq, float width)
+{
+    setTargets(freq, width);
+    const double increment = juce::MathConstants<double>::twoPi * smoothedFreq.getCurrentValue() / sampleRate;
+    smoothedFreq.skip(numSamples);
+    smoothedWidth.skip(numSamples);
+
+    skipNoise(numSamples);
+    lfoPhase = std::fmod(lfoPhase + increment * numSamples, juce::MathConstants<double>::twoPi);
+}
+
+void Modulator::setTargets(float freq, float width)
+{
+    if (!smoothersPrimed) {
+        smoothedFreq.setCurrentAndTargetValue(freq);
+        smoothedWidth.setCurrentAndTargetValue(width);
+        smoothersPrimed = true;
+    }
+    smoothedFreq.setTargetValue(freq);
+    smoothedWidth.setTargetValue(width);
+}
+
+void Modulator::skipNoise(int numSamples)
+{
+    // Keep the stream position in step so the noise stays reproducible from transport start
+    const auto position = noiseSources.front().getPosition() + static_cast<juce::uint32>(numSamples);
+    for (auto& source : noiseSources)
+        source.setPosition(position);
+    noiseRunning = false;
+
+    // Silent noise needs no crossfade out of the tables
+    if (noiseTables == nullptr) {
+        previousTables = nullptr;
+        engineFadePosition = engineFadeLength;
+    }
+}
+
+template <Modulator::Kernel kernel>
+void Modulator::renderSegment(int start, int numSamples, float freq, float width, Quality quality, int numVoices)
+{
+    if constexpr (kernel == Kernel::sineOnly) {
+        // noiseAmount is exactly 0 here
+        skipNoise(numSamples);
+        renderSine(offsetBuffer, start, numSamples, numVoices, freq, quality);
+        return;
+    }
+
+    // The filter state is stale after a sine-only stretch; the width glide brings the noise back in from silence
+    if (!noiseRunning) {
+        std::fill(bandS1.begin(), bandS1.end(), Lanes::expand(0.0f));
+        std::fill(bandS2.begin(), bandS2.end(), Lanes::expand(0.0f));
+        noiseRunning = true;
+    }
+
+    if constexpr (kernel == Kernel::noiseOnly) {
+        // sineAmount is 0 here, just keep the phase moving
+        renderNoise(offsetBuffer, start, numSamples, numVoices, freq, width, quality);
+        lfoPhase = std::fmod(lfoPhase + juce::MathConstants<double>::twoPi * freq / sampleRate * numSamples,
+                             juce::MathConstants<double>::twoPi);
+        return;
+    }
+
+    float sineAmount = 1.0f - power(width, 0.7f, quality); // Lower coefficient means less sine
+    float noiseAmount = 1.0f - sineAmount;
+
+    renderNoise(noiseBuffer, start, numSamples, numVoices, freq, width, quality);
+    renderSine(sineBuffer, start, numSamples, numVoices, freq, quality);
+
+    // Crossfade between noise and sine
+    for (int voice = 0; voice < numVoices; ++voice) {
+        float* offsets = offsetBuffer.getWritePointer(voice, start);
+        juce::FloatVectorOperations::copyWithMultiply(offsets, noiseBuffer.getReadPointer(voice, start), noiseAmount, numSamples);
+        juce::FloatVectorOperations::addWithMultiply(offsets, sineBuffer.getReadPointer(voice, start), sineAmount, numSamples);
+    }
+}
+
+void Modulator::setBandPass(float cutoff, float resonance)
+{
+    bandG = static_cast<float>(std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate));
+    bandR2 = 1.0f / resonance;
+    bandH = 1.0f / (1.0f + bandR2 * bandG + bandG * bandG);
+}
+
+Lanes Modulator::processBandPass(int group, Lanes x) noexcept
+{
+    Lanes& s1 = bandS1[static_cast<size_t>(group)];
+    Lanes& s2 = bandS2[static_cast<size_t>(group)];
+
+    Lanes hp = (x - s1 * (bandG + bandR2) - s2) * bandH;
+    Lanes bp = hp * bandG + s1;
+    s1 = hp * bandG + bp;
+    Lanes lp = bp * bandG + s2;
+    s2 = bp * bandG + lp;
+    return bp;
+}
+
+void Modulator::renderNoise(juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices, float freq, float width, Quality quality)
+{
+    const auto position = noiseSources.front().getPosition();
+
+    const bool useTables = noiseTables != nullptr;
+    if (useTables != tablesPlaying) {
+        // The live filter comes back from silence, the crossfade covers its start
+        if (!useTables) {
+            std::fill(bandS1.begin(), bandS1.end(), Lanes::expand(0.0f));
+            std::fill(bandS2.begin(), bandS2.end(), Lanes::expand(0.0f));
+        }
+        tablesPlaying = useTables;
+        engineFadePosition = useTables || previousTables != nullptr ? 0 : engineFadeLength;
+    }
+
+    if (useTables)
+        renderTableNoise(*noiseTables, dest, start, numSamples, numVoices, freq, width, position);
+    else
+        renderFilteredNoise(dest, start, numSamples, numVoices, freq, width, quality, position);
+
+    // Fade in from the engine that was playing
+    if (engineFadePosition < engineFadeLength) {
+        if (useTables)
+            renderFilteredNoise(fadeBuffer, start, numSamples, numVoices, freq, width, quality, position);
+        else
+            renderTableNoise(*previousTables, fadeBuffer, start, numSamples, numVoices, freq, width, position);
+
+        for (int voice = 0; voice < numVoices; ++voice) {
+            float* noise = dest.getWritePointer(voice, start);
+            const float* fading = fadeBuffer.getReadPointer(voice, start);
+            for (int i = 0; i < numSamples; ++i) {
+                const float amount = juce::jmin(1.0f, static_cast<float>(engineFadePosition + i + 1) / static_cast<float>(engineFadeLength));
+                noise[i] = fading[i] + (noise[i] - fading[i]) * amount;
+            }
+        }
+        engineFadePosition = juce::jmin(engineFadeLength, engineFadePosition + numSamples);
+    }
+    applyNoiseDrive(dest, start, numSamples, numVoices, width, quality);
+
+    if (useTables)
+        previousTables = noiseTables;
+    else if (engineFadePosition == engineFadeLength)
+        previousTables = nullptr;
+
+    // Every stream moves on together, voices sitting this one out stay in step for when Spread comes back
+    for (auto& source : noiseSources)
+        source.setPosition(position + static_cast<juce::uint32>(numSamples));
+}
+
+void Modulator::renderFilteredNoise(juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices, float freq, float width,
+                                    Quality quality, juce::uint32 position)
+{
+    setBandPass(freq, minNoiseQ * power(maxNoiseQ / minNoiseQ, 1.0f - width, quality));
+
+    for (int voice = 0; voice < numVoices; ++voice) {
+        auto& source = noiseSources[static_cast<size_t>(voice)];
+        source.setPosition(position);
+        source.fill(dest.getWritePointer(voice, start), numSamples);
+    }
+
+    // The filter recursion is inherently serial, so it gets its own pass, with the
+    // voices side by side in SIMD lanes
+    const int numGroups = ChannelFrames::getNumGroupsFor(numVoices);
+    noiseFrames.load(dest, start, numSamples, numVoices);
+    for (int i = 0; i < numSamples; ++i)
+        for (int group = 0; group < numGroups; ++group)
+            noiseFrames.set(i, group, processBandPass(group, noiseFrames.get(i, group)));
+    noiseFrames.store(dest, start, numSamples, numVoices);
+}
+
+void Modulator::renderTableNoise(const NoiseTables& tables, juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices,
+                                 float freq, float width, juce::uint32 position)
+{
+    for (int voice = 0; voice < numVoices; ++voice)
+        tables.render(dest.getWritePointer(voice, start), numSamples, position + tableOffsets[static_cast<size_t>(voice)], freq, width);
+}
+
+void Modulator::applyNoiseDrive(juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices, float width, Quality quality)
+{
+    // std::pow here is to balance the loudness of noise, since higher q means louder
+    float gain = power(width, 0.2f, quality); // Lower coefficient means more noise
+    for (int voice = 0; voice < numVoices; ++voice) {
+        float* noise = dest.getWritePointer(voice, start);
+        if (quality == Quality::eco) {
+            for (int i = 0; i < numSamples; ++i)
+                noise[i] = FastMath::tanh(noise[i] * gain);
+        }
+        else {
+            for (int i = 0; i < numSamples; ++i)
+                noise[i] = std::tanh(noise[i] * gain);
+        }
+    }
+}
+
+void Modulator::renderSine(juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices, float freq, Quality quality)
+{
+    constexpr double twoPi = juce::MathConstants<double>::twoPi;
+    const double increment = twoPi * freq / sampleRate;
+    float* sine = dest.getWritePointer(0, start);
+    float* cosine = cosineBuffer.getWritePointer(0, start);
+    const bool spread = numVoices > 1;
+
+    if (quality == Quality::eco) {
+        if (spread)
+            renderPhasorSine<true>(sine, cosine, numSamples, increment);
+        else
+            renderPhasorSine<false>(sine, nullptr, numSamples, increment);
+    }
+    else {
+        for (int i = 0; i < numSamples; ++i) {
+            sine[i] = static_cast<float>(std::sin(lfoPhase));
+            if (spread)
+                cosine[i] = static_cast<float>(std::cos(lfoPhase));
+            lfoPhase += increment;
+            if (lfoPhase >= twoPi) lfoPhase -= twoPi;
+        }
+    }
+
+    // The other voices are voice 0 shifted by voice * pi / numVoices, spread evenly over
+    // half a turn: sin(x + p) = sin(x) cos(p) + cos(x) sin(p)
+    for (int voice = 1; voice < numVoices; ++voice) {
+        const double shift = juce::MathConstants<double>::pi * voice / numVoices;
+        float* out = dest.getWritePointer(voice, start);
+        juce::FloatVectorOperations::copyWithMultiply(out, sine, static_cast<float>(std::cos(shift)), numSamples);
+        juce::FloatVectorOperations::addWithMultiply(out, cosine, static_cast<float>(std::sin(shift)), numSamples);
+    }
+}
+
+template <bool withCosine>
+void Modulator::renderPhasorSine(float* sine, float* cosine, int numSamples, double increment)
+{
+    constexpr double twoPi = juce::MathConstants<double>::twoPi;
+
+    // Lane k runs k samples ahead of lane 0 and every lane advances sineLanes samples per step
+    float offsetRe[sineLanes], offsetIm[sineLanes];
+    for (int lane = 0; lane < sineLanes; ++lane) {
+        offsetRe[lane] = static_cast<float>(std::cos(increment * lane));
+        offsetIm[lane] = static_cast<float>(std::sin(increment * lane));
+    }
+    const float stepRe = static_cast<float>(std::cos(increment * sineLanes));
+    const float stepIm = static_cast<float>(std::sin(increment * sineLanes));
+
+    for (int start = 0; start < numSamples; start += sineAnchorInterval) {
+        const int length = juce::jmin(sineAnchorInterval, numSamples - start);
+        float* out = sine + start;
+        float* outCos = withCosine ? cosine + start : nullptr;
+
+        const float anchorRe = static_cast<float>(std::cos(lfoPhase));
+        const float anchorIm = static_cast<float>(std::sin(lfoPhase));
+        float re[sineLanes], im[sineLanes];
+        for (int lane = 0; lane < sineLanes; ++lane) {
+            re[lane] = anchorRe * offsetRe[lane] - anchorIm * offsetIm[lane];
+            im[lane] = anchorIm * offsetRe[lane] + anchorRe * offsetIm[lane];
+        }
+
+        int i = 0;
+        for (; i + sineLanes <= length; i += sineLanes) {
+            for (int lane = 0; lane < sineLanes; ++lane) {
+                out[i + lane] = im[lane];
+                if constexpr (withCosine)
+                    outCos[i + lane] = re[lane];
+                float nextRe = re[lane] * stepRe - im[lane] * stepIm;
+                im[lane] = im[lane] * stepRe + re[lane] * stepIm;
+                re[lane] = nextRe;
+            }
+        }
+        // Lane k already holds the phase of sample i + k
+        for (int lane = 0; i < length; ++i, ++lane) {
+            out[i] = im[lane];
+            if constexpr (withCosine)
+                outCos[i] = re[lane];
+        }
+
+        lfoPhase = std::fmod(lfoPhase + increment * length, twoPi);
+    }
+}
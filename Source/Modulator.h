@@ -0,0 +1,115 @@
+#pragma once
+#include <JuceHeader.h>
+#include "NoiseGenerator.h"
+#include "FastMath.h"
+#include "ChannelFrames.h"
+#include "NoiseTables.h"
+
+// Renders the delay modulation signal for a whole block: band-passed noise
+// crossfaded with a sine, morphed by width. Each part runs as its own pass over
+// preallocated scratch buffers so the hot loops stay simple and vectorizable.
+// Several decorrelated voices can be rendered at once for Spread; voice 0 is
+// always the same signal a single voice would give. The noise is either filtered
+// live or played back from NoiseTables.
+class Modulator
+{
+public:
+    void prepare(double sampleRate, int maximumBlockSize, juce::uint32 seed, int maximumVoices = 1);
+
+    // Restarts the noise stream, filter and sine phase, snaps the glides to the next
+    // targets and ends any engine fade, so renders from the same starting point are
+    // bit-identical. Call after setNoiseTables() for the block.
+    void reset(juce::uint32 seed);
+
+    int getMaxBlockSize() const { return offsetBuffer.getNumSamples(); }
+    int getMaxVoices() const { return offsetBuffer.getNumChannels(); }
+
+    // Renders numSamples of modulation in [-1, 1] for the first numVoices voices
+    // and returns voice 0, valid until the next call.
+    // freq and width are targets; the modulator glides to them at control rate.
+    const float* render(int numSamples, float freq, float width, Quality quality, int numVoices = 1);
+
+    // The other voices from the last render
+    const float* getVoice(int voice) const { return offsetBuffer.getReadPointer(voice); }
+
+    // Moves time on by numSamples without rendering, for when the output isn't used
+    void advance(int numSamples, float freq, float width);
+
+    // Updates glides four times less often, for when the processor is short of time
+    void setCoarseControl(bool shouldBeCoarse) { coarseControl = shouldBeCoarse; }
+
+    // Plays the noise from pre-rendered tables instead of filtering it live, or
+    // nullptr for the live filter. Switching engines crossfades. The tables must
+    // outlive their use here, until isUsingNoiseTables() turns false or the next prepare().
+    void setNoiseTables(const NoiseTables* newTables) { noiseTables = newTables; }
+    bool isUsingNoiseTables() const noexcept { return noiseTables != nullptr || previousTables != nullptr; }
+
+    // Band-pass resonance of the noise at a width, as Precise computes it; NoiseTables
+    // renders with the same
+    static float getNoiseResonance(float width) { return minNoiseQ * std::pow(maxNoiseQ / minNoiseQ, 1.0f - width); }
+
+private:
+    enum class Kernel { sineOnly, noiseOnly, mixed };
+
+    void setTargets(float freq, float width);
+    void skipNoise(int numSamples);
+    template <Kernel kernel>
+    void renderSegment(int start, int numSamples, float freq, float width, Quality quality, int numVoices);
+    void renderNoise(juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices, float freq, float width, Quality quality);
+    void renderFilteredNoise(juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices, float freq, float width,
+                             Quality quality, juce::uint32 position);
+    void renderTableNoise(const NoiseTables& tables, juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices,
+                          float freq, float width, juce::uint32 position);
+    void applyNoiseDrive(juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices, float width, Quality quality);
+    void renderSine(juce::AudioBuffer<float>& dest, int start, int numSamples, int numVoices, float freq, Quality quality);
+    template <bool withCosine>
+    void renderPhasorSine(float* sine, float* cosine, int numSamples, double increment);
+
+    // Band-pass on every voice at once, one voice per SIMD lane. Same TPT topology
+    // and coefficients as juce::dsp::StateVariableTPTFilter.
+    void setBandPass(float cutoff, float resonance);
+    Lanes processBandPass(int group, Lanes x) noexcept;
+
+    // Samples between filter, Q and mix updates while freq or width are moving
+    static constexpr int controlInterval = 32;
+    static constexpr int coarseControlInterval = 128;
+    static constexpr double smoothingSeconds = 0.05;
+    static constexpr double engineFadeSeconds = 0.01;
+
+    static constexpr float minNoiseQ = 0.5f;
+    static constexpr float maxNoiseQ = 30.0f;
+
+    // Independent phasor lanes, so the rotation loop has no serial dependency
+    static constexpr int sineLanes = 8;
+    // Phasors are re-anchored with std::sin/std::cos this often to bound drift
+    static constexpr int sineAnchorInterval = 256;
+
+    double sampleRate = 44100.0;
+    double lfoPhase = 0.0;
+
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> smoothedFreq;
+    juce::SmoothedValue<float> smoothedWidth;
+    bool smoothersPrimed = false;
+    bool coarseControl = false;
+
+    std::vector<NoiseGenerator> noiseSources; // one stream per voice, all at the same position
+    bool noiseRunning = true; // false after the noise path was skipped
+
+    ChannelFrames noiseFrames; // the voices' noise in SIMD lanes while it is filtered
+    std::vector<Lanes> bandS1, bandS2;
+    float bandG = 0.0f, bandH = 1.0f, bandR2 = 2.0f;
+
+    // Table engine. previousTables is kept for fading out of them.
+    const NoiseTables* noiseTables = nullptr;
+    const NoiseTables* previousTables = nullptr;
+    bool tablesPlaying = false;
+    int engineFadeLength = 1;
+    int engineFadePosition = 1; // engineFadeLength once the fade is done
+    std::vector<juce::uint32> tableOffsets; // per voice
+    juce::AudioBuffer<float> fadeBuffer;    // the engine fading out
+
+    juce::AudioBuffer<float> noiseBuffer;
+    juce::AudioBuffer<float> sineBuffer;
+    juce::AudioBuffer<float> cosineBuffer; // quadrature of voice 0, to phase-shift the other voices
+    juce::AudioBuffer<float> offsetBuffer;
+};
@@ -1,136 +1,351 @@
 #include "NoiseFilterDisplay.h"
+#include "TraceEvents.h"
+
+namespace
+{
+    // Display mode and analyser resolution, kept with the plugin state
+    const juce::Identifier displayModeId { "displayMode" };
+    const juce::Identifier resolutionId { "analyserResolution" };
+    const char* const resolutionNames[] = { "fast", "standard", "multi" };
+}
 
 NoiseFilterDisplay::NoiseFilterDisplay(ErodeAudioProcessor& p, juce::AudioProcessorValueTreeState& state) :
     apvts(state), p(p),
-    fft(p.fftOrder),
-    outfftInput(p.fftSize, 0.0f),
-    outfftData(p.fftSize * 2, 0.0f), 
-    outMagnitudes(p.fftSize / 2, 0.0f),
-    infftInput(p.fftSize, 0.0f),
-    infftData(p.fftSize * 2, 0.0f), 
-    inMagnitudes(p.fftSize / 2, 0.0f),
-	window(p.fftSize, juce::dsp::WindowingFunction<float>::hann)
-{
-    startTimerHz(60);
+    outMagnitudes(SpectrumAnalyser::numPoints, 0.0f),
+    inMagnitudes(SpectrumAnalyser::numPoints, 0.0f)
+{
 	setMouseClickGrabsKeyboardFocus(false);
 	setWantsKeyboardFocus(false);
+
+    // Paints its own background, so the editor behind never needs repainting for it
+    setOpaque(true);
+
+    for (auto* id : { "freq", "width", "amount" })
+        apvts.addParameterListener(id, this);
+    apvts.state.addListener(this);
+
+    if (apvts.state.getProperty(displayModeId).toString() == "waterfall")
+        mode = DisplayMode::waterfall;
+    for (int i = 0; i < juce::numElementsInArray(resolutionNames); ++i)
+        if (apvts.state.getProperty(resolutionId).toString() == resolutionNames[i])
+            resolution = static_cast<SpectrumAnalyser::Resolution>(i);
 }
 
-void NoiseFilterDisplay::timerCallback()
+NoiseFilterDisplay::~NoiseFilterDisplay()
 {
-    // Perform FFT for spectrum display
-    int outputWritePos = p.outputWritePos;
-    auto& outputBuffer = p.outputBuffer;
-    for (int i = 0; i < p.fftSize; ++i) {
-        outfftInput[i] = outputBuffer.getSample(0, (outputWritePos + i) % p.fftSize);
+    for (auto* id : { "freq", "width", "amount" })
+        apvts.removeParameterListener(id, this);
+    apvts.state.removeListener(this);
+
+    if (analyser != nullptr) {
+        analyser.reset();
+        p.detachAnalysisTap();
     }
-	window.multiplyWithWindowingTable(outfftInput.data(), p.fftSize);
-    std::fill(outfftData.begin(), outfftData.end(), 0.0f);
-	std::copy(outfftInput.begin(), outfftInput.end(), outfftData.begin());
-    fft.performRealOnlyForwardTransform(outfftData.data(), true);
-    for (int i = 0; i < p.fftSize / 2; ++i) {
-        float re = outfftData[2 * i];
-        float im = outfftData[2 * i + 1];
-		float mag = std::sqrt(re * re + im * im);
-        outMagnitudes[i] = juce::jmax(mag, outMagnitudes[i] * 0.97f); // peak hold smoothing
+}
+
+void NoiseFilterDisplay::visibilityChanged()
+{
+    updateAnalysisState();
+}
+
+void NoiseFilterDisplay::parentHierarchyChanged()
+{
+    updateAnalysisState();
+}
+
+void NoiseFilterDisplay::updateAnalysisState()
+{
+    const bool showing = isShowing();
+    if (showing == (analyser != nullptr))
+        return;
+
+    if (showing) {
+        analyser = std::make_unique<SpectrumAnalyser>(p.attachAnalysisTap(), p.getSampleRate(), resolution,
+                                                      [this] { triggerAsyncUpdate(); });
+    }
+    else {
+        // Stop the worker touching the tap before handing it back
+        analyser.reset();
+        p.detachAnalysisTap();
+        cancelPendingUpdate();
+        std::fill(inMagnitudes.begin(), inMagnitudes.end(), 0.0f);
+        std::fill(outMagnitudes.begin(), outMagnitudes.end(), 0.0f);
+        updateCurves();
     }
+}
 
-    int inputWritePos = p.inputWritePos;
-    auto& inputBuffer = p.inputBuffer;
-    for (int i = 0; i < p.fftSize; ++i) {
-        infftInput[i] = inputBuffer.getSample(0, (inputWritePos + i) % p.fftSize);
+void NoiseFilterDisplay::handleAsyncUpdate()
+{
+    ERODE_TRACE_THREAD("Message");
+    ERODE_TRACE_SCOPE("display update");
+    if (bandDirty.exchange(false))
+        updateBand();
+
+    // Picks up a new sample rate after the host re-prepares, from the next frame on
+    if (analyser != nullptr)
+        analyser->setSampleRate(p.getSampleRate());
+    if (analyser != nullptr && analyser->getLatest(inMagnitudes, outMagnitudes)) {
+        if (mode == DisplayMode::waterfall)
+            addWaterfallColumn();
+        else
+            updateCurves();
     }
-	window.multiplyWithWindowingTable(infftInput.data(), p.fftSize);
-    std::fill(infftData.begin(), infftData.end(), 0.0f);
-	std::copy(infftInput.begin(), infftInput.end(), infftData.begin());
-    fft.performRealOnlyForwardTransform(infftData.data(), true);
-    for (int i = 0; i < p.fftSize / 2; ++i) {
-        float re = infftData[2 * i];
-        float im = infftData[2 * i + 1];
-		float mag = std::sqrt(re * re + im * im);
-        inMagnitudes[i] = juce::jmax(mag, inMagnitudes[i] * 0.97f);    
+}
+
+void NoiseFilterDisplay::parameterChanged(const juce::String&, float)
+{
+    // Host automation can call this on the audio thread, which must not post messages.
+    // Off the message thread the flag waits for the next frame or the state update.
+    bandDirty = true;
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        triggerAsyncUpdate();
+}
+
+void NoiseFilterDisplay::valueTreePropertyChanged(juce::ValueTree&, const juce::Identifier&)
+{
+    if (bandDirty.exchange(false))
+        updateBand();
+}
+
+void NoiseFilterDisplay::valueTreeRedirected(juce::ValueTree&)
+{
+    bandDirty = false;
+    updateBand();
+}
+
+void NoiseFilterDisplay::updateBand()
+{
+    auto area = getLocalBounds().toFloat();
+    float freq = apvts.getRawParameterValue("freq")->load();
+    float width = apvts.getRawParameterValue("width")->load();
+    float amount = apvts.getRawParameterValue("amount")->load();
+
+    // Map freq (20Hz-20kHz) to X, or to Y from the bottom as a marker on the waterfall's right edge
+    float norm = std::log10(freq / 20.0f) / std::log10(20000.0f / 20.0f);
+    juce::Rectangle<float> newRect;
+    if (mode == DisplayMode::waterfall) {
+        float centerY = area.getBottom() - norm * area.getHeight();
+        float bandHeight = area.getHeight() * juce::jmap(width, 0.0f, 1.0f, 0.01f, 0.5f);
+        newRect = { area.getRight() - bandMarkerWidth, centerY - bandHeight * 0.5f, static_cast<float>(bandMarkerWidth), bandHeight };
+    }
+    else {
+        float centerX = area.getX() + norm * area.getWidth();
+        float bandWidth = area.getWidth() * juce::jmap(width, 0.0f, 1.0f, 0.01f, 0.5f);
+        newRect = { centerX - bandWidth * 0.5f, area.getY(), bandWidth, area.getHeight() };
     }
+
+    bandColour = juce::Colours::deepskyblue.withAlpha(0.5f + (amount - 0.5f) * 0.3f);
+    repaint(bandRect.getUnion(newRect).getSmallestIntegerContainer());
+    bandRect = newRect;
+}
+
+void NoiseFilterDisplay::updateCurves()
+{
+    buildSpectrumPath(outputPath, outMagnitudes);
+    buildSpectrumPath(inputPath, inMagnitudes);
+
+    // The curves span nearly the whole display, so there is no smaller area worth invalidating
     repaint();
 }
 
 void NoiseFilterDisplay::paint(juce::Graphics& g)
 {
-    auto area = getLocalBounds().toFloat();
-    g.fillAll(juce::Colours::black.withAlpha(0.7f));
-
-    // Draw output
-    float binFreq = p.getSampleRate() / (float)p.fftSize;
-    auto freqToX = [area, binFreq](float hz) {
-        float norm = std::log10(hz / 20.0f) / std::log10(20000.0f / 20.0f);
-        return area.getX() + norm * area.getWidth();
-		};
-    float maxDb = -20.0f, minDb = -120.0f;
-    auto magToY = [area, minDb, maxDb](float mag) {
-        float db = juce::Decibels::gainToDecibels(mag, minDb);
-        float norm = juce::jlimit(0.0f, 1.0f, (db - minDb) / (maxDb - minDb));
-        return area.getHeight() * (1.0f - norm);
-        };
-
-	g.setColour(juce::Colours::white.withAlpha(0.7f));
-    juce::Path outputPath;
-    outputPath.startNewSubPath(0, magToY(outMagnitudes[0] / p.fftSize));
-    for (int i = 1; i < (int)outMagnitudes.size(); ++i) {
-		if (binFreq * i < 20.0f || binFreq * i > 20000.0f)
-            continue;
-        outputPath.lineTo(freqToX(binFreq * i), magToY(outMagnitudes[i] / p.fftSize));
-    }
-    g.strokePath(outputPath, juce::PathStrokeType(2.0f));
-
-	g.setColour(juce::Colours::white.withAlpha(0.4f));
-    juce::Path inputPath;
-    inputPath.startNewSubPath(0, magToY(inMagnitudes[0] / p.fftSize));
-    for (int i = 1; i < (int)inMagnitudes.size(); ++i) {
-		if (binFreq * i < 20.0f || binFreq * i > 20000.0f)
-            continue;
-        inputPath.lineTo(freqToX(binFreq * i), magToY(inMagnitudes[i] / p.fftSize));
+    ERODE_TRACE_SCOPE("display paint");
+
+    if (mode == DisplayMode::waterfall && waterfall.isValid()) {
+        ERODE_TRACE_SCOPE("waterfall blit");
+
+        // Oldest column first: [waterfallPos, width) on the left, then [0, waterfallPos)
+        const int w = waterfall.getWidth(), h = waterfall.getHeight();
+        const int older = w - waterfallPos;
+        g.drawImage(waterfall, 0, 0, older, h, waterfallPos, 0, older, h);
+        if (waterfallPos > 0)
+            g.drawImage(waterfall, older, 0, waterfallPos, h, 0, 0, waterfallPos, h);
     }
-    g.strokePath(inputPath, juce::PathStrokeType(2.0f));
+    else {
+        // The translucent black over the editor background, pre-mixed so the display can be opaque
+        g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId)
+                      .overlaidWith(juce::Colours::black.withAlpha(0.7f)));
 
-    float freq = apvts.getRawParameterValue("freq")->load();
-    float width = apvts.getRawParameterValue("width")->load();
-	float amount = apvts.getRawParameterValue("amount")->load();
+        ERODE_TRACE_SCOPE("spectrum paths");
+
+        // Draw output
+        g.setColour(juce::Colours::white.withAlpha(0.7f));
+        g.strokePath(outputPath, juce::PathStrokeType(curveThickness));
 
-    // Map freq (20Hz-20kHz) to X
-    float centerX = freqToX(freq);
-    float bandWidth = area.getWidth() * juce::jmap(width, 0.0f, 1.0f, 0.01f, 0.5f);
+        g.setColour(juce::Colours::white.withAlpha(0.4f));
+        g.strokePath(inputPath, juce::PathStrokeType(curveThickness));
+    }
 
     // Draw bandpass region
-    g.setColour(juce::Colours::deepskyblue.withAlpha(0.5f + (amount - 0.5f) * 0.3f));
-    g.fillRect(centerX - bandWidth * 0.5f, area.getY(), bandWidth, area.getHeight());
+    g.setColour(bandColour);
+    g.fillRect(bandRect);
 }
 
 void NoiseFilterDisplay::resized()
 {
-    // No child components
+    rebuildColumnMap();
+    resetWaterfall();
+    updateCurves();
+    updateBand();
+}
+
+void NoiseFilterDisplay::rebuildColumnMap()
+{
+    mapBins(columns, getWidth());
+    mapBins(rows, getHeight());
+    outputPath.preallocateSpace(getWidth() * 3 + 3);
+    inputPath.preallocateSpace(getWidth() * 3 + 3);
+
+    const int numSteps = juce::jmax(getHeight(), static_cast<int>(palette.size()) - 1);
+    levelThresholds.resize(static_cast<size_t>(numSteps + 1));
+    for (int i = 0; i <= numSteps; ++i) {
+        const float db = minDb + (maxDb - minDb) * static_cast<float>(i) / static_cast<float>(numSteps);
+        levelThresholds[static_cast<size_t>(i)] = juce::Decibels::decibelsToGain(db, minDb - 1.0f);
+    }
+}
+
+void NoiseFilterDisplay::mapBins(std::vector<ColumnBins>& map, int numPixels)
+{
+    map.resize(static_cast<size_t>(juce::jmax(0, numPixels)));
+
+    // The grid is log-spaced over the same 20 Hz - 20 kHz as the display, so pixels map to it linearly
+    const double pointsPerPixel = static_cast<double>(SpectrumAnalyser::numPoints) / juce::jmax(1, numPixels);
+    for (int x = 0; x < numPixels; ++x)
+        map[static_cast<size_t>(x)] = ColumnBins::map(x * pointsPerPixel, (x + 1) * pointsPerPixel, SpectrumAnalyser::numPoints);
+}
+
+float NoiseFilterDisplay::getLevel(const ColumnBins& column, const std::vector<float>& magnitudes) const
+{
+    if (levelThresholds.size() < 2)
+        return 0.0f;
+
+    // The last threshold at or under the gain
+    const float gain = column.read(magnitudes.data());
+    const auto above = std::upper_bound(levelThresholds.begin(), levelThresholds.end(), gain) - levelThresholds.begin();
+    const auto numSteps = static_cast<int>(levelThresholds.size()) - 1;
+    return static_cast<float>(juce::jlimit(0, numSteps, static_cast<int>(above) - 1)) / static_cast<float>(numSteps);
+}
+
+void NoiseFilterDisplay::buildSpectrumPath(juce::Path& path, const std::vector<float>& magnitudes)
+{
+    path.clear();
+    if (columns.empty())
+        return;
+
+    const float height = static_cast<float>(getHeight());
+    for (size_t x = 0; x < columns.size(); ++x) {
+        float y = height * (1.0f - getLevel(columns[x], magnitudes));
+
+        if (x == 0)
+            path.startNewSubPath(0.0f, y);
+        else
+            path.lineTo(static_cast<float>(x), y);
+    }
+}
+
+void NoiseFilterDisplay::setResolution(SpectrumAnalyser::Resolution newResolution)
+{
+    resolution = newResolution;
+    apvts.state.setProperty(resolutionId, resolutionNames[static_cast<int>(resolution)], nullptr);
+    if (analyser != nullptr)
+        analyser->setResolution(resolution);
+}
+
+void NoiseFilterDisplay::setMode(DisplayMode newMode)
+{
+    mode = newMode;
+    apvts.state.setProperty(displayModeId, mode == DisplayMode::waterfall ? "waterfall" : "spectrum", nullptr);
+    resetWaterfall();
+    if (mode == DisplayMode::spectrum)
+        updateCurves();
+    updateBand();
+    repaint();
+}
+
+void NoiseFilterDisplay::resetWaterfall()
+{
+    if (mode != DisplayMode::waterfall || getWidth() <= 0 || getHeight() <= 0) {
+        waterfall = {};
+        return;
+    }
+
+    // Quiet bins fade into the display background, loud ones run through the knob colours to white
+    const auto background = getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId)
+                                .overlaidWith(juce::Colours::black.withAlpha(0.7f));
+    juce::ColourGradient gradient(background, 0.0f, 0.0f, juce::Colours::white, 1.0f, 0.0f, false);
+    gradient.addColour(0.35, juce::Colour(0xff0d47a1));
+    gradient.addColour(0.6, juce::Colours::deepskyblue);
+    gradient.addColour(0.85, juce::Colour(0xffb3e5fc));
+    for (size_t i = 0; i < palette.size(); ++i)
+        palette[i] = gradient.getColourAtPosition(static_cast<double>(i) / (palette.size() - 1));
+
+    // History is dropped on resize, the rows no longer match. A software image, so
+    // writing a column each frame doesn't copy a native one back and forth.
+    waterfall = juce::Image(juce::Image::RGB, getWidth(), getHeight(), false, juce::SoftwareImageType());
+    waterfall.clear(waterfall.getBounds(), palette[0]);
+    waterfallPos = 0;
+}
+
+void NoiseFilterDisplay::addWaterfallColumn()
+{
+    if (!waterfall.isValid() || static_cast<int>(rows.size()) != waterfall.getHeight())
+        return;
+
+    // Only the newest column is written, the history already in the image stays as it is
+    const int height = waterfall.getHeight();
+    juce::Image::BitmapData pixels(waterfall, waterfallPos, 0, 1, height, juce::Image::BitmapData::writeOnly);
+    for (int y = 0; y < height; ++y) {
+        const float level = getLevel(rows[static_cast<size_t>(height - 1 - y)], outMagnitudes);
+        pixels.setPixelColour(0, y, palette[static_cast<size_t>(level * (palette.size() - 1))]);
+    }
+
+    waterfallPos = (waterfallPos + 1) % waterfall.getWidth();
+    repaint();
+}
+
+void NoiseFilterDisplay::showModeMenu()
+{
+    juce::Component::SafePointer<NoiseFilterDisplay> safeThis(this);
+    juce::PopupMenu menu;
+    menu.addItem("Spectrum", true, mode == DisplayMode::spectrum, [safeThis] {
+        if (safeThis != nullptr)
+            safeThis->setMode(DisplayMode::spectrum);
+    });
+    menu.addItem("Waterfall", true, mode == DisplayMode::waterfall, [safeThis] {
+        if (safeThis != nullptr)
+            safeThis->setMode(DisplayMode::waterfall);
+    });
+
+    menu.addSectionHeader("Analyser resolution");
+    const std::pair<SpectrumAnalyser::Resolution, const char*> resolutions[] = {
+        { SpectrumAnalyser::Resolution::fast, "1024-point FFT" },
+        { SpectrumAnalyser::Resolution::standard, "2048-point FFT" },
+        { SpectrumAnalyser::Resolution::multi, "Multi-resolution" },
+    };
+    for (const auto& [choice, name] : resolutions) {
+        menu.addItem(name, true, resolution == choice, [safeThis, choice = choice] {
+            if (safeThis != nullptr)
+                safeThis->setResolution(choice);
+        });
+    }
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this));
 }
 
 void NoiseFilterDisplay::mouseDown(const juce::MouseEvent& e)
 {
-    // Get current freq/width
-    float freq = apvts.getRawParameterValue("freq")->load();
-    float width = apvts.getRawParameterValue("width")->load();
+    if (e.mods.isPopupMenu()) {
+        showModeMenu();
+        return;
+    }
 
-    // Calculate band rectangle
-    auto area = getLocalBounds().toFloat();
-    auto freqToX = [area](float hz) {
-        float norm = std::log10(hz / 20.0f) / std::log10(20000.0f / 20.0f);
-        return area.getX() + norm * area.getWidth();
-        };
-    float centerX = freqToX(freq);
-    float bandWidth = area.getWidth() * juce::jmap(width, 0.0f, 1.0f, 0.01f, 0.5f);
-    juce::Rectangle<float> bandRect(centerX - bandWidth * 0.5f, area.getY(), bandWidth, area.getHeight());
-
-    if (bandRect.contains(e.position))
+    // The band is only dragged on the spectrum, where X is frequency
+    if (mode == DisplayMode::spectrum && bandRect.contains(e.position))
     {
         draggingBand = true;
         dragStart = e.position;
-        startFreq = freq;
-        startWidth = width;
+        startFreq = apvts.getRawParameterValue("freq")->load();
+        startWidth = apvts.getRawParameterValue("width")->load();
     }
 }
 
@@ -1,26 +1,78 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "SpectrumAnalyser.h"
+#include <array>
 
-class NoiseFilterDisplay : public juce::Component, private juce::Timer
+class NoiseFilterDisplay : public juce::Component,
+                           private juce::AsyncUpdater,
+                           private juce::AudioProcessorValueTreeState::Listener,
+                           private juce::ValueTree::Listener
 {
 public:
     NoiseFilterDisplay(ErodeAudioProcessor& p, juce::AudioProcessorValueTreeState& apvts);
+    ~NoiseFilterDisplay() override;
     void paint(juce::Graphics&) override;
     void resized() override;
+    void visibilityChanged() override;
+    void parentHierarchyChanged() override;
 
 private:
     juce::AudioProcessorValueTreeState& apvts;
     ErodeAudioProcessor& p;
 
-	juce::dsp::FFT fft;
-    std::vector<float> outfftInput;
-    std::vector<float> outfftData;
+    // Latest magnitudes published by the background analyser, on its log-spaced grid
     std::vector<float> outMagnitudes;
-    std::vector<float> infftInput;
-    std::vector<float> infftData;
     std::vector<float> inMagnitudes;
-    juce::dsp::WindowingFunction<float> window;
+
+    // Grid points drawn in each pixel column, rebuilt on resize
+    using ColumnBins = SpectrumAnalyser::BinRange;
+    std::vector<ColumnBins> columns;
+    std::vector<ColumnBins> rows; // the same for the waterfall's rows, bottom up
+    juce::Path outputPath, inputPath;
+    static constexpr float curveThickness = 2.0f;
+
+    void rebuildColumnMap();
+    static void mapBins(std::vector<ColumnBins>& map, int numPixels);
+    // Display level in [0, 1] of the bins mapped to one pixel, in steps of a pixel
+    // row or a palette entry, whichever is finer
+    float getLevel(const ColumnBins& bins, const std::vector<float>& magnitudes) const;
+    // Gains at the step edges from minDb to maxDb, rebuilt on resize so drawing needs no logs
+    std::vector<float> levelThresholds;
+    static constexpr float minDb = -120.0f, maxDb = -20.0f;
+    void buildSpectrumPath(juce::Path& path, const std::vector<float>& magnitudes);
+    // Rebuilds the curves from the latest magnitudes and repaints
+    void updateCurves();
+
+    // Band overlay, only touched when freq, width or amount change. Changes made on
+    // the audio thread are picked up by the next analyser frame, or when the APVTS
+    // copies parameter values into its state on the message thread.
+    juce::Rectangle<float> bandRect;
+    juce::Colour bandColour;
+    std::atomic<bool> bandDirty { true };
+    void updateBand();
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void valueTreePropertyChanged(juce::ValueTree&, const juce::Identifier&) override;
+    void valueTreeRedirected(juce::ValueTree&) override;
+
+    // Waterfall of the wet signal, picked from the context menu. The image is a ring
+    // of columns: each analyser frame writes one column and paint() blits the ring
+    // from the oldest column, so a frame costs the same however much history is shown.
+    enum class DisplayMode { spectrum, waterfall };
+    DisplayMode mode = DisplayMode::spectrum;
+    juce::Image waterfall;
+    int waterfallPos = 0; // next column to write, which is also the oldest one shown
+    std::array<juce::Colour, 256> palette;
+    static constexpr int bandMarkerWidth = 6;
+
+    // Analyser resolution, also picked from the context menu
+    SpectrumAnalyser::Resolution resolution = SpectrumAnalyser::Resolution::multi;
+    void setResolution(SpectrumAnalyser::Resolution newResolution);
+
+    void setMode(DisplayMode newMode);
+    void resetWaterfall();
+    void addWaterfallColumn();
+    void showModeMenu();
 
 	// for mouse interaction on band
     juce::Point<float> dragStart;
@@ -32,5 +84,9 @@ private:
 	void mouseDrag(const juce::MouseEvent& e) override;
 	void mouseUp(const juce::MouseEvent& e) override;
 
-    void timerCallback() override;
+    void handleAsyncUpdate() override;
+
+    // Analysis only runs while the display is actually on screen
+    void updateAnalysisState();
+    std::unique_ptr<SpectrumAnalyser> analyser;
 };
\ No newline at end of file
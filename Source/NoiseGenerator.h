@@ -0,0 +1,42 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Counter-based white noise. Sample n of a stream is a pure hash of (seed, n),
+// so a block fills in one branch-free pass the compiler can vectorize, and a
+// given seed and position always reproduce the same samples. The counter is
+// 32 bits wide, which repeats after about 27 hours at 44.1 kHz.
+class NoiseGenerator
+{
+public:
+    void setSeed(juce::uint32 newSeed) noexcept { key = hash(newSeed ^ 0x9e3779b9u); }
+    void setPosition(juce::uint32 sampleIndex) noexcept { counter = sampleIndex; }
+    juce::uint32 getPosition() const noexcept { return counter; }
+
+    // Fills dest with uniform noise in [-1, 1) and advances the position
+    void fill(float* dest, int numSamples) noexcept
+    {
+        const juce::uint32 start = counter;
+        const juce::uint32 k = key;
+        for (int i = 0; i < numSamples; ++i) {
+            juce::uint32 bits = hash(hash(start + static_cast<juce::uint32>(i)) ^ k);
+            // Top 24 bits fit a float mantissa exactly
+            dest[i] = static_cast<float>(static_cast<int>(bits >> 8)) * (2.0f / 16777216.0f) - 1.0f;
+        }
+        counter = start + static_cast<juce::uint32>(numSamples);
+    }
+
+private:
+    // lowbias32 integer hash by Chris Wellons
+    static juce::uint32 hash(juce::uint32 x) noexcept
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    juce::uint32 key = 0;
+    juce::uint32 counter = 0;
+};
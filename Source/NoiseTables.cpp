@@ -0,0 +1,291 @@
+#include "NoiseTables.h"
+#include "Modulator.h"
+#include "NoiseGenerator.h"
+#include "SharedTables.h"
+#include "TraceEvents.h"
+
+std::unique_ptr<NoiseTables> NoiseTables::build(double sampleRate, const std::function<bool()>& shouldStop)
+{
+    ERODE_TRACE_SCOPE("noise tables");
+    std::unique_ptr<NoiseTables> tables(new NoiseTables());
+
+    struct Band { double freq; float r2; };
+    std::array<Band, numLoops> bands;
+    size_t total = 0;
+    juce::uint32 longest = 0;
+    for (int f = 0; f < numFreqs; ++f) {
+        for (int w = 0; w < numWidths; ++w) {
+            // Same band-pass and Q as the modulator's live filter
+            const double freq = juce::jmin(minFreq * std::exp2(static_cast<double>(f) / pointsPerOctave), 0.49 * sampleRate);
+            const float q = Modulator::getNoiseResonance(static_cast<float>(w) / (numWidths - 1));
+            const double seconds = juce::jmax(minLoopSeconds, linesPerBand * q / freq);
+
+            auto& loop = tables->loops[static_cast<size_t>(getLoopIndex(f, w))];
+            loop.start = total;
+            loop.length = static_cast<juce::uint32>(std::ceil(seconds * sampleRate));
+            bands[static_cast<size_t>(getLoopIndex(f, w))] = { freq, 1.0f / q };
+            total += loop.length;
+            longest = juce::jmax(longest, loop.length);
+        }
+    }
+    tables->samples.resize(total);
+    std::vector<float> white(longest);
+
+    for (int i = 0; i < numLoops; ++i) {
+        if (shouldStop())
+            return nullptr;
+
+        auto& loop = tables->loops[static_cast<size_t>(i)];
+        const int length = static_cast<int>(loop.length);
+        const float g = static_cast<float>(std::tan(juce::MathConstants<double>::pi * bands[static_cast<size_t>(i)].freq / sampleRate));
+        const float r2 = bands[static_cast<size_t>(i)].r2;
+        const float h = 1.0f / (1.0f + r2 * g + g * g);
+
+        NoiseGenerator noise;
+        noise.setSeed(static_cast<juce::uint32>(i));
+        noise.fill(white.data(), length);
+
+        float s1 = 0.0f, s2 = 0.0f;
+        const auto tick = [&](float x) {
+            const float hp = (x - s1 * (g + r2) - s2) * h;
+            const float bp = hp * g + s1;
+            s1 = hp * g + bp;
+            const float lp = bp * g + s2;
+            s2 = bp * g + lp;
+            return bp;
+        };
+
+        // The impulse response's energy times the white noise's power is the live
+        // filter's level. Loops last well over the filter's ring time, so it has died away.
+        double impulseEnergy = 0.0;
+        for (int n = 0; n < length; ++n)
+            impulseEnergy += juce::square(static_cast<double>(tick(n == 0 ? 1.0f : 0.0f)));
+        s1 = s2 = 0.0f;
+
+        // The first pass settles the filter on the loop, so the stored pass wraps seamlessly
+        for (int n = 0; n < length; ++n)
+            tick(white[static_cast<size_t>(n)]);
+
+        float* out = tables->samples.data() + loop.start;
+        double whitePower = 0.0, power = 0.0;
+        for (int n = 0; n < length; ++n) {
+            out[n] = tick(white[static_cast<size_t>(n)]);
+            whitePower += juce::square(static_cast<double>(white[static_cast<size_t>(n)]));
+            power += juce::square(static_cast<double>(out[n]));
+        }
+
+        // A few lines per band still land at random levels, so scale each loop to the live level
+        loop.level = static_cast<float>(std::sqrt(impulseEnergy * whitePower / length));
+        if (power > 0.0)
+            juce::FloatVectorOperations::multiply(out, static_cast<float>(loop.level / std::sqrt(power / length)), length);
+    }
+    return tables;
+}
+
+void NoiseTables::render(float* dest, int numSamples, juce::uint32 position, float freq, float width) const noexcept
+{
+    const float x = juce::jlimit(0.0f, static_cast<float>(numFreqs - 1), std::log2(freq / minFreq) * pointsPerOctave);
+    const float y = juce::jlimit(0.0f, 1.0f, width) * (numWidths - 1);
+    const int f = juce::jmin(static_cast<int>(x), numFreqs - 2);
+    const int w = juce::jmin(static_cast<int>(y), numWidths - 2);
+    const float a = x - static_cast<float>(f);
+    const float b = y - static_cast<float>(w);
+
+    struct Corner { const Loop& loop; float weight; };
+    Corner corners[] { { loops[static_cast<size_t>(getLoopIndex(f, w))],         (1.0f - a) * (1.0f - b) },
+                       { loops[static_cast<size_t>(getLoopIndex(f + 1, w))],     a * (1.0f - b) },
+                       { loops[static_cast<size_t>(getLoopIndex(f, w + 1))],     (1.0f - a) * b },
+                       { loops[static_cast<size_t>(getLoopIndex(f + 1, w + 1))], a * b } };
+
+    // The loops are uncorrelated, so their powers add: scale the weights to bring the
+    // mix up to the blend of the four levels rather than dipping between points
+    float level = 0.0f, power = 0.0f;
+    for (auto& corner : corners) {
+        level += corner.weight * corner.loop.level;
+        power += juce::square(corner.weight * corner.loop.level);
+    }
+    const float scale = power > 0.0f ? level / std::sqrt(power) : 0.0f;
+
+    juce::FloatVectorOperations::clear(dest, numSamples);
+    for (auto& corner : corners) {
+        if (corner.weight <= 0.0f)
+            continue;
+
+        auto index = position % corner.loop.length;
+        for (int done = 0; done < numSamples;) {
+            const int length = static_cast<int>(juce::jmin(static_cast<juce::uint32>(numSamples - done), corner.loop.length - index));
+            juce::FloatVectorOperations::addWithMultiply(dest + done, samples.data() + corner.loop.start + index,
+                                                          corner.weight * scale, length);
+            done += length;
+            index = 0;
+        }
+    }
+}
+
+juce::uint32 NoiseTables::getStartOffset(juce::uint32 seed, int voice) noexcept
+{
+    NoiseGenerator noise;
+    noise.setSeed(seed + static_cast<juce::uint32>(voice) * 0x9e3779b9u);
+    float value = 0.0f;
+    noise.fill(&value, 1);
+    // Any 24 bits, taken modulo each loop's length when played
+    return static_cast<juce::uint32>((value + 1.0f) * 8388608.0f);
+}
+
+//==============================================================================
+NoiseTableLoader::NoiseTableLoader()
+{
+    builder->add(this);
+}
+
+NoiseTableLoader::~NoiseTableLoader()
+{
+    builder->remove(this);
+}
+
+void NoiseTableLoader::prepare(double newSampleRate)
+{
+    const juce::ScopedLock sl(lock);
+    if (newSampleRate != sampleRate) {
+        state = state.load() & requestedBit;
+        tables.reset();
+        sampleRate = newSampleRate;
+    }
+
+    if (tables == nullptr) {
+        tables = SharedTables::find<NoiseTables>({ "noise tables", NoiseTables::numLoops, sampleRate });
+        if (tables != nullptr)
+            state = reinterpret_cast<std::uintptr_t>(tables.get()) | (state.load() & requestedBit);
+    }
+
+    // Starts the builder polling for this loader's requests
+    builder->wake();
+}
+
+void NoiseTableLoader::release()
+{
+    const juce::ScopedLock sl(lock);
+    state = 0;
+    tables.reset();
+    sampleRate = 0.0;
+}
+
+void NoiseTableLoader::buildNow()
+{
+    state.fetch_or(requestedBit);
+    const double rate = update();
+    if (rate > 0.0)
+        deliver(rate, fetch(rate, [] { return false; }));
+}
+
+std::shared_ptr<const NoiseTables> NoiseTableLoader::fetch(double rate, const std::function<bool()>& shouldStop)
+{
+    const SharedTables::Key key { "noise tables", NoiseTables::numLoops, rate };
+    if (auto existing = SharedTables::find<NoiseTables>(key))
+        return existing;
+
+    auto built = NoiseTables::build(rate, shouldStop);
+    if (built == nullptr)
+        return nullptr;
+    return SharedTables::get<NoiseTables>(key, [&built] { return std::move(built); });
+}
+
+double NoiseTableLoader::update()
+{
+    const juce::ScopedLock sl(lock);
+    const auto current = state.load(std::memory_order_acquire);
+    if (current == 0) {
+        tables.reset();
+        return 0.0;
+    }
+
+    if (current != requestedBit)
+        return 0.0;
+
+    if (tables == nullptr)
+        return sampleRate;
+
+    publish();
+    return 0.0;
+}
+
+bool NoiseTableLoader::isPrepared() const
+{
+    const juce::ScopedLock sl(lock);
+    return sampleRate > 0.0;
+}
+
+void NoiseTableLoader::deliver(double builtSampleRate, std::shared_ptr<const NoiseTables> builtTables)
+{
+    const juce::ScopedLock sl(lock);
+    if (builtTables == nullptr || builtSampleRate != sampleRate || tables != nullptr)
+        return;
+
+    tables = std::move(builtTables);
+    publish();
+}
+
+void NoiseTableLoader::publish() noexcept
+{
+    // Only if the request still stands, a drop in the meantime leaves them for update() to free
+    auto expected = requestedBit;
+    state.compare_exchange_strong(expected, reinterpret_cast<std::uintptr_t>(tables.get()) | requestedBit,
+                                  std::memory_order_release, std::memory_order_relaxed);
+}
+
+//==============================================================================
+NoiseTableBuilder::NoiseTableBuilder() : juce::Thread("Erode noise tables")
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+NoiseTableBuilder::~NoiseTableBuilder()
+{
+    signalThreadShouldExit();
+    work.signal();
+    stopThread(1000);
+}
+
+void NoiseTableBuilder::add(NoiseTableLoader* loader)
+{
+    const juce::ScopedLock sl(lock);
+    loaders.addIfNotAlreadyThere(loader);
+}
+
+void NoiseTableBuilder::remove(NoiseTableLoader* loader)
+{
+    const juce::ScopedLock sl(lock);
+    loaders.removeFirstMatchingValue(loader);
+}
+
+void NoiseTableBuilder::run()
+{
+    ERODE_TRACE_THREAD("Noise tables");
+    while (!threadShouldExit()) {
+        NoiseTableLoader* target = nullptr;
+        double rate = 0.0;
+        bool anyPrepared = false;
+        {
+            const juce::ScopedLock sl(lock);
+            for (auto* loader : loaders) {
+                anyPrepared = anyPrepared || loader->isPrepared();
+                rate = loader->update();
+                if (rate > 0.0) {
+                    target = loader;
+                    break;
+                }
+            }
+        }
+
+        if (target == nullptr) {
+            work.wait(anyPrepared ? pollMs : -1);
+            continue;
+        }
+
+        // Built without holding the lock, then only handed over if the loader is still around
+        auto tables = NoiseTableLoader::fetch(rate, [this] { return threadShouldExit(); });
+        const juce::ScopedLock sl(lock);
+        if (loaders.contains(target))
+            target->deliver(rate, std::move(tables));
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Pre-rendered loops of the modulator's band-passed noise on a grid of freq and
+// width (which sets the Q) points. Playing them back is a few multiply-adds per
+// sample with no filter recursion, so whole blocks vectorise. A loop's spectrum is
+// lines spaced by its repeat rate, so each lasts long enough, in seconds, to put
+// several lines inside its band, and is scaled to the live filter's level. Every
+// loop is filtered from its own white noise, and between grid points the four
+// neighbours are mixed with weights that keep the summed power at the blended
+// level. One set per sample rate, shared through SharedTables.
+class NoiseTables
+{
+public:
+    static constexpr float minFreq = 20.0f;
+    static constexpr int pointsPerOctave = 4;
+    static constexpr int numFreqs = 10 * pointsPerOctave + 1; // up to 20.48 kHz
+    static constexpr int numWidths = 5;
+    static constexpr int numLoops = numFreqs * numWidths;
+
+    // Spectral lines per bandwidth (freq / Q), which sets how long each loop is
+    static constexpr double linesPerBand = 8.0;
+    static constexpr double minLoopSeconds = 0.25;
+
+    // Renders every loop, about 27 MB at 48 kHz and in proportion at other rates.
+    // Returns nullptr if shouldStop() turns true first.
+    static std::unique_ptr<NoiseTables> build(double sampleRate, const std::function<bool()>& shouldStop);
+
+    // numSamples of band-passed noise for freq and width from a position in the loops,
+    // at the level the live filter gives
+    void render(float* dest, int numSamples, juce::uint32 position, float freq, float width) const noexcept;
+
+    // Where a voice starts in the loops, so seeds and voices play different stretches
+    static juce::uint32 getStartOffset(juce::uint32 seed, int voice) noexcept;
+
+private:
+    NoiseTables() = default;
+
+    struct Loop
+    {
+        size_t start = 0;
+        juce::uint32 length = 0;
+        float level = 0.0f; // RMS
+    };
+
+    static int getLoopIndex(int freqIndex, int widthIndex) noexcept { return freqIndex * numWidths + widthIndex; }
+
+    std::array<Loop, numLoops> loops;
+    std::vector<float> samples;
+};
+
+class NoiseTableLoader;
+
+// One background thread building and freeing tables for every loader in the process.
+// The audio thread only flips a loader's atomic state, which can't signal an event
+// without a lock, so the builder polls while any loader is prepared and otherwise
+// sleeps until prepare() wakes it.
+class NoiseTableBuilder : private juce::Thread
+{
+public:
+    NoiseTableBuilder();
+    ~NoiseTableBuilder() override;
+
+    void add(NoiseTableLoader* loader);
+    // Once this returns, nothing more is delivered to the loader
+    void remove(NoiseTableLoader* loader);
+
+    // Not from the audio thread
+    void wake() { work.signal(); }
+
+private:
+    void run() override;
+
+    static constexpr int pollMs = 100;
+
+    juce::WaitableEvent work;
+    juce::CriticalSection lock;
+    juce::Array<NoiseTableLoader*> loaders;
+};
+
+// A processor's handle on the tables for its sample rate. They are built on a
+// background thread shared by every instance the first time the audio thread asks
+// for them, get() returns nullptr until they are ready, and they are freed on that
+// thread once the audio thread gives them up with drop().
+class NoiseTableLoader
+{
+public:
+    NoiseTableLoader();
+    ~NoiseTableLoader();
+
+    // While the audio thread is stopped. Takes up the tables of another instance
+    // at the same rate straight away.
+    void prepare(double sampleRate);
+    void release();
+
+    // Builds the tables on the calling thread unless they are ready, for offline renders
+    void buildNow();
+
+    // Audio thread, only while the tables are wanted. Lock-free: the builder picks the
+    // request up on its next poll.
+    const NoiseTables* get() noexcept
+    {
+        auto current = state.load(std::memory_order_acquire);
+        if ((current & requestedBit) == 0)
+            current = state.fetch_or(requestedBit, std::memory_order_acq_rel) | requestedBit;
+        return reinterpret_cast<const NoiseTables*>(current & ~requestedBit);
+    }
+
+    // Audio thread, once the tables are neither wanted nor still being played. Nothing
+    // from get() may be used after this, the builder frees them on its next poll.
+    void drop() noexcept
+    {
+        if (state.load(std::memory_order_relaxed) != 0)
+            state.store(0, std::memory_order_release);
+    }
+
+private:
+    friend class NoiseTableBuilder;
+
+    static std::shared_ptr<const NoiseTables> fetch(double sampleRate, const std::function<bool()>& shouldStop);
+    // Publishes held tables that are asked for and frees ones that were dropped.
+    // Returns the rate to build for, or 0 when there is nothing to build.
+    double update();
+    bool isPrepared() const;
+    void deliver(double builtSampleRate, std::shared_ptr<const NoiseTables> builtTables);
+    void publish() noexcept;
+
+    // The published tables, with the low bit set while the audio thread asks for
+    // them. The audio thread only ever clears the pointer and the builder only ever
+    // sets it, so tables are freed only once the audio thread has let go of them.
+    static constexpr std::uintptr_t requestedBit = 1;
+    static_assert(alignof(NoiseTables) > requestedBit);
+    std::atomic<std::uintptr_t> state { 0 };
+
+    juce::CriticalSection lock; // sampleRate and tables
+    double sampleRate = 0.0;
+    std::shared_ptr<const NoiseTables> tables;
+
+    juce::SharedResourcePointer<NoiseTableBuilder> builder;
+
+    JUCE_DECLARE_NON_COPYABLE(NoiseTableLoader)
+};
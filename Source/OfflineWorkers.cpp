@@ -0,0 +1,128 @@
+#include "OfflineWorkers.h"
+#include "TraceEvents.h"
+
+class OfflineWorkers::Helper : public juce::Thread
+{
+public:
+    Helper(OfflineWorkers& ownerToUse, int sliceToRun) :
+        juce::Thread("Erode render " + juce::String(sliceToRun)),
+        owner(ownerToUse),
+        slice(sliceToRun)
+    {
+    }
+
+    ~Helper() override
+    {
+        signalThreadShouldExit();
+        wake.signal();
+        stopThread(1000);
+    }
+
+    juce::WaitableEvent wake;
+
+private:
+    void run() override
+    {
+        ERODE_TRACE_THREAD("Render helper");
+        juce::WorkgroupToken token;
+        int joinedVersion = -1;
+
+        for (;;) {
+            wake.wait(-1);
+            if (threadShouldExit())
+                return;
+
+            owner.joinWorkgroup(token, joinedVersion);
+            owner.runSlice(slice);
+            owner.pending.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    OfflineWorkers& owner;
+    const int slice;
+};
+
+//==============================================================================
+OfflineWorkers::OfflineWorkers() = default;
+
+OfflineWorkers::~OfflineWorkers()
+{
+    stop();
+}
+
+int OfflineWorkers::getHelpersFor(int numGroups)
+{
+    return juce::jlimit(0, maxHelpers, juce::jmin(getNumLines(numGroups), juce::SystemStats::getNumPhysicalCpus()) - 1);
+}
+
+void OfflineWorkers::start(int numHelpers)
+{
+    if (static_cast<int>(helpers.size()) == numHelpers)
+        return;
+
+    stop();
+    for (int i = 0; i < numHelpers; ++i) {
+        helpers.push_back(std::make_unique<Helper>(*this, i + 1));
+
+        // Workgroups only take realtime threads; without the rights for one a plain thread does
+        if (!helpers.back()->startRealtimeThread(juce::Thread::RealtimeOptions {}))
+            helpers.back()->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+void OfflineWorkers::stop()
+{
+    helpers.clear();
+}
+
+void OfflineWorkers::setWorkgroup(const juce::AudioWorkgroup& newWorkgroup)
+{
+    {
+        const juce::SpinLock::ScopedLockType sl(workgroupLock);
+        workgroup = newWorkgroup;
+    }
+    ++workgroupVersion;
+}
+
+void OfflineWorkers::joinWorkgroup(juce::WorkgroupToken& token, int& joinedVersion)
+{
+    const int version = workgroupVersion.load();
+    if (version == joinedVersion)
+        return;
+
+    joinedVersion = version;
+    token.reset();
+    const juce::SpinLock::ScopedLockType sl(workgroupLock);
+    if (workgroup)
+        workgroup.join(token);
+}
+
+void OfflineWorkers::runJob(int numGroupsToRun, Job jobToRun, void* contextToUse)
+{
+    numSlices = juce::jmin(getNumLines(numGroupsToRun), static_cast<int>(helpers.size()) + 1);
+    if (numSlices <= 1) {
+        jobToRun(contextToUse, 0, numGroupsToRun);
+        return;
+    }
+
+    job = jobToRun;
+    context = contextToUse;
+    numGroups = numGroupsToRun;
+    pending = numSlices - 1;
+    for (int slice = 1; slice < numSlices; ++slice)
+        helpers[static_cast<size_t>(slice - 1)]->wake.signal();
+
+    runSlice(0);
+    while (pending.load(std::memory_order_acquire) > 0)
+        juce::Thread::yield();
+}
+
+void OfflineWorkers::runSlice(int slice) noexcept
+{
+    // Whole cache lines of groups per slice
+    const int numLines = getNumLines(numGroups);
+    const auto getEdge = [&](int s) {
+        return juce::jmin(numGroups, numLines * s / numSlices * ChannelFrames::groupsPerCacheLine);
+    };
+    job(context, getEdge(slice), getEdge(slice + 1));
+}
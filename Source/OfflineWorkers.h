@@ -0,0 +1,65 @@
+#pragma once
+#include <JuceHeader.h>
+#include "ChannelFrames.h"
+
+// Helper threads for offline renders. run() splits a chunk's channel groups into
+// contiguous slices of whole cache lines (ChannelFrames::groupsPerCacheLine groups),
+// one per helper plus one for the calling thread, and returns once every slice is
+// done. Buses of up to 16 channels fit one line and stay on the calling thread. Handing work to other threads has no bounded latency,
+// so this is only for non-realtime renders, where there is no deadline to miss.
+class OfflineWorkers
+{
+public:
+    OfflineWorkers();
+    ~OfflineWorkers();
+
+    // Helpers worth starting for a bus of numGroups channel groups
+    static int getHelpersFor(int numGroups);
+
+    // Starts numHelpers threads, or does nothing when that many are already running
+    void start(int numHelpers);
+    void stop();
+
+    // Helpers join the host's audio workgroup where the platform has them (Apple)
+    void setWorkgroup(const juce::AudioWorkgroup& newWorkgroup);
+
+    // Calls function(firstGroup, endGroup) for every slice of [0, numGroups)
+    template <typename Function>
+    void run(int numGroups, Function& function)
+    {
+        runJob(numGroups, [](void* context, int firstGroup, int endGroup) {
+            (*static_cast<Function*>(context))(firstGroup, endGroup);
+        }, &function);
+    }
+
+private:
+    using Job = void (*)(void* context, int firstGroup, int endGroup);
+
+    class Helper;
+    void runJob(int numGroupsToRun, Job jobToRun, void* contextToUse);
+    void runSlice(int slice) noexcept;
+    void joinWorkgroup(juce::WorkgroupToken& token, int& joinedVersion);
+
+    static constexpr int maxHelpers = 3;
+
+    // Slices are whole cache lines of a frame, so no two threads write the same line
+    static int getNumLines(int numGroups)
+    {
+        return (numGroups + ChannelFrames::groupsPerCacheLine - 1) / ChannelFrames::groupsPerCacheLine;
+    }
+
+    std::vector<std::unique_ptr<Helper>> helpers;
+
+    // The current job, written before the helpers are woken
+    Job job = nullptr;
+    void* context = nullptr;
+    int numGroups = 0;
+    int numSlices = 1;
+    std::atomic<int> pending { 0 };
+
+    juce::SpinLock workgroupLock;
+    juce::AudioWorkgroup workgroup;
+    std::atomic<int> workgroupVersion { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(OfflineWorkers)
+};
@@ -8,6 +8,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "TraceEvents.h"
 
 //==============================================================================
 ErodeAudioProcessorEditor::ErodeAudioProcessorEditor (ErodeAudioProcessor& p)
@@ -52,6 +53,13 @@ ErodeAudioProcessorEditor::ErodeAudioProcessorEditor (ErodeAudioProcessor& p)
 	addAndMakeVisible(cutLabel);
 	addAndMakeVisible(filterDisplay);
 
+	loadLabel.setJustificationType(juce::Justification::centredRight);
+	loadLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
+	loadLabel.setTooltip("Share of each audio block's time budget Erode used over the last half second: mean, 99th percentile and worst block");
+	addAndMakeVisible(loadLabel);
+	lastLoadSnapshot = p.getLoadMeter().getSnapshot();
+	startTimerHz(2);
+
 	setLookAndFeel(&erodeLnf);
     setSize(400, 200);
     setResizable(true, true);
@@ -67,6 +75,7 @@ ErodeAudioProcessorEditor::~ErodeAudioProcessorEditor()
 //==============================================================================
 void ErodeAudioProcessorEditor::paint (juce::Graphics& g)
 {
+    ERODE_TRACE_SCOPE("editor paint");
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 }
 
@@ -84,6 +93,10 @@ void ErodeAudioProcessorEditor::resized()
 	for (auto* l : { &freqLabel, &widthLabel, &amountLabel, &cutLabel })
 		l->setFont(juce::Font(fontSize));
 
+	auto loadArea = getLocalBounds().removeFromBottom(juce::roundToInt(getHeight() * 0.08f));
+	loadLabel.setBounds(loadArea.removeFromRight(getWidth() / 2).reduced(getWidth() / 100, 0));
+	loadLabel.setFont(juce::Font(getHeight() * 0.05f));
+
 	float margin = 0.07f;
 	area.reduce(area.getWidth() * margin, area.getHeight() * margin * 2);
 
@@ -105,3 +118,18 @@ void ErodeAudioProcessorEditor::resized()
 		}
 	}
 }
+
+void ErodeAudioProcessorEditor::timerCallback()
+{
+	// Only the blocks since the last tick, so a spike shows briefly and then clears
+	const auto snapshot = audioProcessor.getLoadMeter().getSnapshot();
+	const auto stats = LoadMeter::getStatistics(lastLoadSnapshot, snapshot);
+	lastLoadSnapshot = snapshot;
+
+	if (stats.numBlocks == 0)
+		loadLabel.setText("DSP idle", juce::dontSendNotification);
+	else
+		loadLabel.setText(juce::String::formatted("DSP %.1f%%  p99 %.1f%%  max %.1f%%",
+		                                          stats.meanLoad * 100.0, stats.p99Load * 100.0, stats.maxLoad * 100.0),
+		                  juce::dontSendNotification);
+}
@@ -16,7 +16,7 @@
 //==============================================================================
 /**
 */
-class ErodeAudioProcessorEditor  : public juce::AudioProcessorEditor {
+class ErodeAudioProcessorEditor  : public juce::AudioProcessorEditor, private juce::Timer {
 public:
     ErodeAudioProcessorEditor (ErodeAudioProcessor&);
     ~ErodeAudioProcessorEditor() override;
@@ -26,6 +26,8 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     ErodeAudioProcessor& audioProcessor;
@@ -48,6 +50,9 @@ private:
 
 	NoiseFilterDisplay filterDisplay;
 
+	juce::Label loadLabel;
+	LoadMeter::Snapshot lastLoadSnapshot;
+
 	juce::TooltipWindow tolltipWindow { this };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ErodeAudioProcessorEditor)
@@ -8,8 +8,10 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "TraceEvents.h"
+
+static const juce::Identifier seedId("seed");
 
-constexpr float twoPi = juce::MathConstants<float>::twoPi;
 //==============================================================================
 juce::AudioProcessorValueTreeState::ParameterLayout ErodeAudioProcessor::createParameterLayout()
 {
@@ -36,6 +38,29 @@ juce::AudioProcessorValueTreeState::ParameterLayout ErodeAudioProcessor::createP
         "Cut",
         juce::NormalisableRange<float>(20.0f, 20000.0f, 1.0f, 0.3f),
         20.0f));
+    // Eco trades bounded approximation error in the modulator for lower CPU
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "quality",
+        "Quality",
+        juce::StringArray { "Precise", "Eco" },
+        0));
+    // Fractional delay read; higher tiers keep more top end under heavy modulation
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "interp",
+        "Interpolation",
+        juce::StringArray { "Linear", "Hermite", "Sinc" },
+        0));
+    // Gives every channel its own noise stream and sine phase for a wider image
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        "spread",
+        "Spread",
+        false));
+    // Tables plays the modulator noise from pre-rendered loops instead of filtering it live
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "noise",
+        "Noise",
+        juce::StringArray { "Live", "Tables" },
+        0));
     return layout;
 }
 
@@ -52,10 +77,17 @@ ErodeAudioProcessor::ErodeAudioProcessor()
     apvts (*this, nullptr, "Parameters", createParameterLayout())
 #endif
 {
+    // Each new instance gets its own noise stream; restored sessions bring theirs back
+    setNoiseSeed(static_cast<juce::uint32>(juce::Random::getSystemRandom().nextInt()));
 }
 
 ErodeAudioProcessor::~ErodeAudioProcessor()
 {
+   #if ERODE_TRACE
+    // The standalone app has no other hook for getting the trace out
+    if (wrapperType == wrapperType_Standalone)
+        TraceEvents::writeToFile(TraceEvents::getDefaultFile());
+   #endif
 }
 
 //==============================================================================
@@ -123,41 +155,89 @@ void ErodeAudioProcessor::changeProgramName (int index, const juce::String& newN
 //==============================================================================
 void ErodeAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-	const int numSamples = static_cast<int>(sampleRate * 0.1); // 100 ms max delay
-    delayBuffer.setSize(getTotalNumOutputChannels(), 100);
-    delayBuffer.clear();
-	
-    writePosition = 0;
-    lfoPhase = 0.0f;
-
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
-    filter.prepare(spec);
-    filter.setType(juce::dsp::StateVariableTPTFilterType::bandpass);
-    outputHPF.resize(getTotalNumInputChannels());
-    for (auto& hpf : outputHPF) {
-		hpf.reset();
-		hpf.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, 2000.0f, 0.5f);
-    }
+    baseDelaySamples = static_cast<float>(sampleRate * baseDelayMs * 0.001);
+    depthSamples = static_cast<float>(sampleRate * depthMs * 0.001);
+    delayLine.prepare(getTotalNumOutputChannels(), static_cast<int>(std::ceil(baseDelaySamples + depthSamples)));
+
+    modulator.prepare(sampleRate, samplesPerBlock, noiseSeed.load(), getTotalNumInputChannels());
+    noiseTables.prepare(sampleRate);
+    loadMeter.prepare(sampleRate);
+    loadGovernor.prepare(sampleRate);
+    wasPlaying = false;
+    cutFilter.prepare(sampleRate, getTotalNumInputChannels());
  
     
-	outputBuffer.setSize(1, fftSize);
-    outputBuffer.clear();
-    outputWritePos = 0;
-	inputBuffer.setSize(1, fftSize);
-    inputBuffer.clear();
-	inputWritePos = 0;
+    frames.prepare(getTotalNumInputChannels(), modulator.getMaxBlockSize());
+    tapScratch.setSize(2, modulator.getMaxBlockSize());
+    cutCoefficients.resize(static_cast<size_t>(modulator.getMaxBlockSize()));
+    controlScratch.setSize(4, modulator.getMaxBlockSize());
+    spreadDelays.setSize(getTotalNumInputChannels(), modulator.getMaxBlockSize());
+    spreadFrames.prepare(getTotalNumInputChannels(), modulator.getMaxBlockSize());
 
 	smoothedAmount.reset(sampleRate, 0.05);
 	smoothedAmount.setCurrentAndTargetValue(apvts.getRawParameterValue("amount")->load());
+	smoothedSpread.reset(sampleRate, 0.05);
+	smoothedSpread.setCurrentAndTargetValue(apvts.getRawParameterValue("spread")->load());
+	smoothedCut.reset(sampleRate, 0.05);
+	smoothedCut.setCurrentAndTargetValue(apvts.getRawParameterValue("cut")->load());
+
+    activeInterpolation = fadeFrom = static_cast<Interpolation>(static_cast<int>(apvts.getRawParameterValue("interp")->load()));
+    fadeLength = juce::jmax(1, juce::roundToInt(sampleRate * interpolationFadeSeconds));
+    fadePosition = fadeLength;
+
+    prepared = true;
+    prepareRenderMode();
 }
 
 void ErodeAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    prepared = false;
+    offlineWorkers.stop();
+    noiseTables.release();
+}
+
+void ErodeAudioProcessor::setNonRealtime (bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime(isNonRealtime);
+
+    // Hosts may call this from any thread, even the audio one, so the thread starts and
+    // the table build wait for the message thread. Until then blocks run on this thread.
+    if (prepared)
+        triggerAsyncUpdate();
+}
+
+void ErodeAudioProcessor::handleAsyncUpdate()
+{
+    if (prepared)
+        prepareRenderMode();
+}
+
+void ErodeAudioProcessor::prepareRenderMode()
+{
+    {
+        // Hosts may switch while blocks are running
+        const juce::ScopedLock sl(getCallbackLock());
+        if (isNonRealtime())
+            offlineWorkers.start(OfflineWorkers::getHelpersFor(frames.getNumGroups()));
+        else
+            offlineWorkers.stop();
+    }
+
+    // Renders mustn't depend on how far the background build got. Outside the lock,
+    // the tables only swap in through the loader.
+    if (isNonRealtime())
+        waitForNoiseTables();
+}
+
+void ErodeAudioProcessor::waitForNoiseTables()
+{
+    if (static_cast<int>(apvts.getRawParameterValue("noise")->load()) == 1)
+        noiseTables.buildNow();
+}
+
+void ErodeAudioProcessor::audioWorkgroupContextChanged (const juce::AudioWorkgroup& workgroup)
+{
+    offlineWorkers.setWorkgroup(workgroup);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -167,8 +247,10 @@ bool ErodeAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) co
     juce::ignoreUnused (layouts);
     return true;
   #else
-      if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout works, channels are processed in SIMD groups: mono, stereo,
+    // surround, immersive and ambisonic buses up to maxChannels
+    const auto& output = layouts.getMainOutputChannelSet();
+    if (output.isDisabled() || output.size() > maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -184,108 +266,304 @@ bool ErodeAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) co
 
 void ErodeAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    const LoadMeter::ScopedTimer loadTimer(loadMeter, buffer.getNumSamples());
+    ERODE_TRACE_THREAD("Audio");
+    ERODE_TRACE_SCOPE("processBlock");
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     const int numSamples = buffer.getNumSamples();
-    const int bufferSize = delayBuffer.getNumSamples();
-    const float sampleRate = getSampleRate();
-    float offset = 0.0f;
-    float noise = 0.0f;
-    float sine = 0.0f;
-	smoothedAmount.setTargetValue(apvts.getRawParameterValue("amount")->load());
-	float sAmount = smoothedAmount.getNextValue();
-	float mix = sAmount;
-    float amount = mix * 20.0f;
-    int delayInSamples = 30;
+    smoothedAmount.setTargetValue(apvts.getRawParameterValue("amount")->load());
     float freq = apvts.getRawParameterValue("freq")->load();
     float width = apvts.getRawParameterValue("width")->load();
-    float minQ = 0.5f;
-    float maxQ = 30.0f;
-    float q = minQ * std::pow(maxQ / minQ, 1.0f - width);
-    float sineAmount = 1.0f - std::pow(width, 0.7f); // Lower coefficient means less sine
-    float noiseAmount = 1.0f - sineAmount;
-	smoothedCut.setTargetValue(apvts.getRawParameterValue("cut")->load());
-	float sCut = smoothedCut.getNextValue();
-    for (auto& hpf : outputHPF) {
-		hpf.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, sCut, 0.5f);
-    }
-
-	filter.setCutoffFrequency(freq);
-	filter.setResonance(q);
+    const auto quality = static_cast<Quality>(static_cast<int>(apvts.getRawParameterValue("quality")->load()));
+    const auto interpolation = static_cast<Interpolation>(static_cast<int>(apvts.getRawParameterValue("interp")->load()));
+    smoothedCut.setTargetValue(apvts.getRawParameterValue("cut")->load());
+    smoothedSpread.setTargetValue(apvts.getRawParameterValue("spread")->load());
+    const bool tablesWanted = static_cast<int>(apvts.getRawParameterValue("noise")->load()) == 1;
 
-    float outputMonoSum = 0.0f;
-	float inputMonoSum = 0.0f;
+    float* dryTap = tapScratch.getWritePointer(0);
+    float* wetTap = tapScratch.getWritePointer(1);
+    float* mixValues = controlScratch.getWritePointer(0);
+    float* delayValues = controlScratch.getWritePointer(1);
 
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, numSamples);
 
-    for (int sample = 0; sample < numSamples; ++sample) {
-        // Smoothing per sample
-		sAmount = smoothedAmount.getNextValue();
-		mix = sAmount;
-		amount = mix * 20.0f;
+    // Everything restarts on transport start, below, so every render from the same point matches
+    bool isPlaying = false;
+    if (auto* playHead = getPlayHead())
+        if (auto position = playHead->getPosition())
+            isPlaying = position->getIsPlaying();
+    const bool restart = isPlaying && !wasPlaying;
+    wasPlaying = isPlaying;
+
+    // Only bother with the display sums while someone is looking
+    ++audioThreadUsingTap;
+    auto* tap = analysisEnabled.load() ? analysisTap.get() : nullptr;
+
+    // Offline renders have no deadline: always the best tiers, and wide buses share
+    // their channel groups out over helper threads. Live, the governor gives up
+    // quality while blocks run close to their deadline.
+    const bool offline = isNonRealtime();
+    LoadGovernor::Settings settings { interpolation, quality, false, tap != nullptr };
+    if (offline) {
+        settings.quality = Quality::precise;
+        settings.interpolation = Interpolation::sinc;
+        loadGovernor.reset();
+    }
+    else if (loadGovernorEnabled.load()) {
+        loadGovernor.update(loadMeter.getLastLoad(), numSamples, settings);
+        settings = loadGovernor.apply(settings);
+    }
+    else {
+        loadGovernor.reset();
+    }
+    modulator.setCoarseControl(settings.coarseControl);
+    // Until the tables are built the live filter stands in
+    modulator.setNoiseTables(tablesWanted ? noiseTables.get() : nullptr);
+    if (!tablesWanted && !modulator.isUsingNoiseTables())
+        noiseTables.drop();
+    if (!settings.feedAnalysis)
+        tap = nullptr;
+
+    // No history from the last pass: delay and filter state cleared, glides and
+    // fades snapped to where this block asks for
+    if (restart) {
+        modulator.reset(noiseSeed.load());
+        delayLine.reset();
+        cutFilter.reset();
+        smoothedAmount.setCurrentAndTargetValue(smoothedAmount.getTargetValue());
+        smoothedCut.setCurrentAndTargetValue(smoothedCut.getTargetValue());
+        smoothedSpread.setCurrentAndTargetValue(smoothedSpread.getTargetValue());
+        activeInterpolation = fadeFrom = settings.interpolation;
+        fadePosition = fadeLength;
+    }
+
+    // A different interpolator crossfades in from the old one's reads
+    if (settings.interpolation != activeInterpolation) {
+        fadeFrom = activeInterpolation;
+        activeInterpolation = settings.interpolation;
+        fadePosition = 0;
+    }
+
+    // Hosts can exceed the announced block size, so work in chunks the modulator can hold
+    for (int start = 0; start < numSamples; start += modulator.getMaxBlockSize()) {
+        const int chunkSize = juce::jmin(modulator.getMaxBlockSize(), numSamples - start);
+        const bool fading = fadePosition < fadeLength;
+
+        if (tap != nullptr) {
+            juce::FloatVectorOperations::clear(dryTap, chunkSize);
+            for (int channel = 0; channel < totalNumInputChannels; ++channel)
+                juce::FloatVectorOperations::add(dryTap, buffer.getReadPointer(channel, start), chunkSize);
+        }
 
-		sCut = smoothedCut.getNextValue();
-        for (auto& hpf : outputHPF) {
-			hpf.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, sCut, 0.5f);
+        // Amount parked at zero: the output is the dry signal, so only keep the delay
+        // line and modulator time moving. Leaving it ramps Amount up from silence.
+        if (!smoothedAmount.isSmoothing() && smoothedAmount.getTargetValue() == 0.0f) {
+            modulator.advance(chunkSize, freq, width);
+            smoothedCut.skip(chunkSize);
+            smoothedSpread.skip(chunkSize);
+            frames.load(buffer, start, chunkSize);
+            for (int i = 0; i < chunkSize; ++i)
+                for (int group = 0; group < frames.getNumGroups(); ++group)
+                    delayLine.push(group, frames.get(i, group), i);
+            delayLine.advance(chunkSize);
+            fadePosition = juce::jmin(fadeLength, fadePosition + chunkSize);
+
+            if (tap != nullptr)
+                juce::FloatVectorOperations::clear(wetTap, chunkSize);
         }
+        else {
+            // Spread only costs extra voices while it is on or fading
+            const bool spread = totalNumInputChannels > 1
+                             && (smoothedSpread.isSmoothing() || smoothedSpread.getTargetValue() > 0.0f);
+            const int numVoices = spread ? totalNumInputChannels : 1;
+
+            // While fading, both interpolators must be able to read every delay
+            const float minimumDelay = fading ? juce::jmax(DelayLine::getMinimumDelay(fadeFrom), DelayLine::getMinimumDelay(activeInterpolation))
+                                              : DelayLine::getMinimumDelay(activeInterpolation);
+
+            // Render the chunk's modulation before touching the delay line
+            const float* offsets = modulator.render(chunkSize, freq, width, settings.quality, numVoices);
+
+            // Delay per sample: the base delay swept by depth * Amount
+            for (int i = 0; i < chunkSize; ++i)
+                mixValues[i] = smoothedAmount.getNextValue();
+            juce::FloatVectorOperations::multiply(delayValues, offsets, mixValues, chunkSize);
+            juce::FloatVectorOperations::multiply(delayValues, -depthSamples, chunkSize);
+            juce::FloatVectorOperations::add(delayValues, baseDelaySamples, chunkSize);
+            juce::FloatVectorOperations::max(delayValues, delayValues, minimumDelay, chunkSize);
+
+            if (spread) {
+                // Each channel fades from the shared voice 0 delay to its own by the Spread amount
+                float* spreadAmounts = controlScratch.getWritePointer(2);
+                for (int i = 0; i < chunkSize; ++i)
+                    spreadAmounts[i] = smoothedSpread.getNextValue();
+
+                juce::FloatVectorOperations::copy(spreadDelays.getWritePointer(0), delayValues, chunkSize);
+                for (int voice = 1; voice < numVoices; ++voice) {
+                    float* voiceDelays = spreadDelays.getWritePointer(voice);
+                    juce::FloatVectorOperations::subtract(voiceDelays, modulator.getVoice(voice), offsets, chunkSize);
+                    juce::FloatVectorOperations::multiply(voiceDelays, spreadAmounts, chunkSize);
+                    juce::FloatVectorOperations::add(voiceDelays, offsets, chunkSize);
+                    juce::FloatVectorOperations::multiply(voiceDelays, mixValues, chunkSize);
+                    juce::FloatVectorOperations::multiply(voiceDelays, -depthSamples, chunkSize);
+                    juce::FloatVectorOperations::add(voiceDelays, baseDelaySamples, chunkSize);
+                    juce::FloatVectorOperations::max(voiceDelays, voiceDelays, minimumDelay, chunkSize);
+                }
+                spreadFrames.load(spreadDelays, 0, chunkSize);
+            }
+            else {
+                smoothedSpread.skip(chunkSize);
+            }
+
+            // Cutoff coefficients are per sample and shared by every group
+            for (int i = 0; i < chunkSize; ++i)
+                cutCoefficients[static_cast<size_t>(i)] = cutFilter.getCoefficients(smoothedCut.getNextValue());
+
+            const float* fadeValues = nullptr;
+            if (fading) {
+                float* ramp = controlScratch.getWritePointer(3);
+                for (int i = 0; i < chunkSize; ++i)
+                    ramp[i] = juce::jmin(1.0f, static_cast<float>(fadePosition + i + 1) / static_cast<float>(fadeLength));
+                fadePosition = juce::jmin(fadeLength, fadePosition + chunkSize);
+                fadeValues = ramp;
+            }
+
+            frames.load(buffer, start, chunkSize);
+            switch (activeInterpolation) {
+                case Interpolation::hermite: processChunk<Interpolation::hermite>(chunkSize, mixValues, delayValues, fadeValues, spread, offline); break;
+                case Interpolation::sinc:    processChunk<Interpolation::sinc>(chunkSize, mixValues, delayValues, fadeValues, spread, offline); break;
+                case Interpolation::linear:
+                default:                     processChunk<Interpolation::linear>(chunkSize, mixValues, delayValues, fadeValues, spread, offline); break;
+            }
+            frames.store(buffer, start, chunkSize);
+
+            // The output is wet + dry * (1 - mix), so the wet sum is what the dry share leaves
+            if (tap != nullptr) {
+                juce::FloatVectorOperations::clear(wetTap, chunkSize);
+                for (int channel = 0; channel < totalNumInputChannels; ++channel)
+                    juce::FloatVectorOperations::add(wetTap, buffer.getReadPointer(channel, start), chunkSize);
+                for (int i = 0; i < chunkSize; ++i) {
+                    dryTap[i] *= 1.0f - mixValues[i];
+                    wetTap[i] -= dryTap[i];
+                }
+            }
+        }
+
+        // Hand the chunk's mono sums to the display in one go
+        if (tap != nullptr) {
+            const float channelScale = 1.0f / static_cast<float>(juce::jmax(1, totalNumInputChannels));
+            juce::FloatVectorOperations::multiply(dryTap, channelScale, chunkSize);
+            juce::FloatVectorOperations::multiply(wetTap, channelScale, chunkSize);
+            tap->push(dryTap, wetTap, chunkSize);
+        }
+    }
+    --audioThreadUsingTap;
+}
+
+template <Interpolation interpolation>
+void ErodeAudioProcessor::processChunk(int numFrames, const float* mixValues, const float* delayValues, const float* fadeValues,
+                                       bool spread, bool useWorkers)
+{
+    ERODE_TRACE_SCOPE("delay + cut");
+    auto processSlice = [&](int firstGroup, int endGroup) {
+        if (fadeValues != nullptr) {
+            if (spread)
+                processGroups<interpolation, true, true>(firstGroup, endGroup, numFrames, mixValues, delayValues, fadeValues);
+            else
+                processGroups<interpolation, false, true>(firstGroup, endGroup, numFrames, mixValues, delayValues, fadeValues);
+        }
+        else {
+            if (spread)
+                processGroups<interpolation, true, false>(firstGroup, endGroup, numFrames, mixValues, delayValues, nullptr);
+            else
+                processGroups<interpolation, false, false>(firstGroup, endGroup, numFrames, mixValues, delayValues, nullptr);
+        }
+    };
+
+    if (useWorkers)
+        offlineWorkers.run(frames.getNumGroups(), processSlice);
+    else
+        processSlice(0, frames.getNumGroups());
+    delayLine.advance(numFrames);
+}
 
-		noise = rand.nextFloat() * 2.0f - 1.0f;
-        
-        // std::pow here is to balance the loudness of noise, since higher q means louder
-		noise = filter.processSample(0, noise) * std::pow(width, 0.2f); // Lower coefficient means more noise
-		noise = std::tanh(noise);
-
-		sine = std::sin(lfoPhase);
-		lfoPhase += twoPi * freq / sampleRate;
-		if (lfoPhase >= twoPi) lfoPhase -= twoPi;
-
-        // Crossfade between noise and sine
-        offset = noiseAmount * noise + sineAmount * sine;
-
-		float readPosition = writePosition - delayInSamples + offset * amount;
-		while (readPosition < 0) readPosition += bufferSize;
-		while (readPosition >= bufferSize) readPosition -= bufferSize;
-		int index0 = static_cast<int>(readPosition);
-		int index1 = (index0 + 1) % bufferSize;
-        float fraction = readPosition - static_cast<int>(readPosition);
-
-		outputMonoSum = 0.0f;
-        inputMonoSum = 0.0f;
-
-		for (int channel = 0; channel < totalNumInputChannels; ++channel) {
-			auto* channelData = buffer.getWritePointer(channel);
-			auto* delayData = delayBuffer.getWritePointer(channel);
-
-            float inputSample = channelData[sample];
-			float outputSample = delayData[index0] * (1 - fraction) + delayData[index1] * fraction;
-            outputSample = outputHPF[channel].processSample(outputSample) * mix;
-            delayData[writePosition] = inputSample;
-			inputSample *= (1.0f - mix);
-
-			outputMonoSum += outputSample;
-            inputMonoSum += inputSample;
-
-            channelData[sample] = outputSample + inputSample;
-            
-            // For testing the modulator wave
-            //channelData[sample] = offset;
+template <Interpolation interpolation, bool spread>
+Lanes ErodeAudioProcessor::readDelay(int group, int frame, const float* delayValues,
+                                     const DelayLine::SincKernel& sincKernel) const noexcept
+{
+    if constexpr (spread)
+        return delayLine.read<interpolation>(group, spreadFrames.get(frame, group), frame);
+    else if constexpr (interpolation == Interpolation::sinc)
+        return delayLine.read(group, sincKernel, frame);
+    else
+        return delayLine.read<interpolation>(group, delayValues[frame], frame);
+}
+
+template <Interpolation interpolation, bool spread, bool fading>
+void ErodeAudioProcessor::processGroups(int firstGroup, int endGroup, int numFrames, const float* mixValues, const float* delayValues,
+                                        const float* fadeValues)
+{
+    // Every group shares the frame's delay without spread, so a sinc read's blended
+    // coefficients are built once per frame here instead of once per group
+    const bool sharedSinc = !spread && (interpolation == Interpolation::sinc || (fading && fadeFrom == Interpolation::sinc));
+
+    for (int i = 0; i < numFrames; ++i) {
+        const float mix = mixValues[i];
+        const auto cut = cutCoefficients[static_cast<size_t>(i)];
+        DelayLine::SincKernel sincKernel;
+        if (sharedSinc)
+            sincKernel = DelayLine::getSincKernel(delayValues[i]);
+
+        for (int group = firstGroup; group < endGroup; ++group) {
+            const Lanes input = frames.get(i, group);
+            Lanes delayed = readDelay<interpolation, spread>(group, i, delayValues, sincKernel);
+            if constexpr (fading) {
+                Lanes previous;
+                switch (fadeFrom) {
+                    case Interpolation::hermite: previous = readDelay<Interpolation::hermite, spread>(group, i, delayValues, sincKernel); break;
+                    case Interpolation::sinc:    previous = readDelay<Interpolation::sinc, spread>(group, i, delayValues, sincKernel); break;
+                    case Interpolation::linear:
+                    default:                     previous = readDelay<Interpolation::linear, spread>(group, i, delayValues, sincKernel); break;
+                }
+                delayed = previous + (delayed - previous) * fadeValues[i];
+            }
+            const Lanes wet = cutFilter.process(group, delayed, cut) * mix;
+            const Lanes dry = input * (1.0f - mix);
+            delayLine.push(group, input, i);
+            frames.set(i, group, wet + dry);
         }
-		outputMonoSum /= static_cast<float>(totalNumInputChannels);
-		outputBuffer.setSample(0, outputWritePos, outputMonoSum);
-		outputWritePos++;
-		if (outputWritePos >= fftSize) outputWritePos = 0;
-		inputMonoSum /= static_cast<float>(totalNumInputChannels);
-		inputBuffer.setSample(0, inputWritePos, inputMonoSum);
-		inputWritePos++;
-		if (inputWritePos >= fftSize) inputWritePos = 0;
-        writePosition++;
-        if (writePosition >= bufferSize) writePosition = 0;
     }
 }
 
+AnalysisTap& ErodeAudioProcessor::attachAnalysisTap()
+{
+    JUCE_ASSERT_MESSAGE_MANAGER_IS_LOCKED
+    if (analysisTapUsers++ == 0) {
+        analysisTap = std::make_unique<AnalysisTap>();
+        analysisEnabled = true;
+    }
+    return *analysisTap;
+}
+
+void ErodeAudioProcessor::detachAnalysisTap()
+{
+    JUCE_ASSERT_MESSAGE_MANAGER_IS_LOCKED
+    jassert(analysisTapUsers > 0);
+    if (--analysisTapUsers > 0)
+        return;
+
+    // The audio thread announces itself before checking the flag, so once it is
+    // cleared and nobody is inside processBlock the tap can go
+    analysisEnabled = false;
+    while (audioThreadUsingTap.load() > 0)
+        juce::Thread::yield();
+    analysisTap.reset();
+}
+
 //==============================================================================
 bool ErodeAudioProcessor::hasEditor() const
 {
@@ -311,9 +589,20 @@ void ErodeAudioProcessor::setStateInformation (const void* data, int sizeInBytes
 	if (xml != nullptr && xml->hasTagName(apvts.state.getType())) {
         auto state = juce::ValueTree::fromXml(*xml);
         apvts.replaceState(state);
+
+        if (apvts.state.hasProperty(seedId))
+            noiseSeed = static_cast<juce::uint32>(static_cast<int>(apvts.state.getProperty(seedId)));
+        else
+            setNoiseSeed(noiseSeed.load()); // older sessions keep this instance's seed
     }
 }
 
+void ErodeAudioProcessor::setNoiseSeed(juce::uint32 seed)
+{
+    noiseSeed = seed;
+    apvts.state.setProperty(seedId, static_cast<int>(seed), nullptr);
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
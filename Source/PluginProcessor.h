@@ -9,11 +9,19 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "CutFilter.h"
+#include "DelayLine.h"
+#include "Modulator.h"
+#include "AnalysisTap.h"
+#include "LoadMeter.h"
+#include "LoadGovernor.h"
+#include "OfflineWorkers.h"
 
 //==============================================================================
 /**
 */
-class ErodeAudioProcessor  : public juce::AudioProcessor
+class ErodeAudioProcessor  : public juce::AudioProcessor,
+                             private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -29,6 +37,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void audioWorkgroupContextChanged (const juce::AudioWorkgroup& workgroup) override;
+    void setNonRealtime (bool isNonRealtime) noexcept override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -55,27 +65,96 @@ public:
 
 	juce::AudioProcessorValueTreeState& getAPVTS() { return apvts; }
 
-    static constexpr int fftOrder = 11;
-	static constexpr int fftSize = 1 << fftOrder; // fftSize = 2^fftOrder
+    // Seed of the modulator noise, saved with the plugin state so renders are reproducible.
+    // Takes effect on the next transport start or prepareToPlay.
+    juce::uint32 getNoiseSeed() const { return noiseSeed.load(); }
+    void setNoiseSeed(juce::uint32 seed);
 
-	std::vector<juce::dsp::IIR::Filter<float>> outputHPF;
-    juce::AudioBuffer<float> outputBuffer;
-    std::atomic<int> outputWritePos = 0;
-	juce::AudioBuffer<float> inputBuffer;
-	std::atomic<int> inputWritePos = 0;
+    // Widest bus accepted, e.g. 7th-order ambisonics
+    static constexpr int maxChannels = 64;
+
+    // Dry and wet mono sums for the spectrum display. The tap only exists and is
+    // only fed while a display holds it; every attach needs a matching detach.
+    AnalysisTap& attachAnalysisTap();
+    void detachAnalysisTap();
+
+    // Timing of every processBlock against its deadline, readable from any thread
+    const LoadMeter& getLoadMeter() const { return loadMeter; }
+
+    // Lets processBlock step quality down while it runs short of its deadline and back
+    // up when there is room again. On by default; offline renders never use it.
+    void setLoadGovernorEnabled(bool shouldBeEnabled) { loadGovernorEnabled = shouldBeEnabled; }
+    // The LoadGovernor::Stage in effect, readable from any thread
+    int getLoadGovernorStage() const { return loadGovernor.getStage(); }
+
+    // With Noise set to Tables, blocks until the tables for the current sample rate
+    // exist, so tools never hear the live filter that stands in while they build
+    void waitForNoiseTables();
 
 private:
     //==============================================================================
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    // Starts the offline helpers and builds the noise tables ahead of an offline
+    // render, or stops the helpers for realtime, so processBlock only dispatches.
+    // From prepareToPlay, or from the message thread after setNonRealtime.
+    void prepareRenderMode();
+    void handleAsyncUpdate() override;
+    std::atomic<bool> prepared { false };
+
+    // Delay read, cut filter and dry/wet for one chunk already loaded into frames.
+    // With spread, each channel reads at its own delay from spreadFrames. Channel
+    // groups are independent, so offline renders split them over offlineWorkers.
+    // fadeValues, when given, crossfade each read from fadeFrom's interpolator.
+    template <Interpolation interpolation>
+    void processChunk(int numFrames, const float* mixValues, const float* delayValues, const float* fadeValues,
+                      bool spread, bool useWorkers);
+    template <Interpolation interpolation, bool spread, bool fading>
+    void processGroups(int firstGroup, int endGroup, int numFrames, const float* mixValues, const float* delayValues,
+                       const float* fadeValues);
+    // Without spread, sinc reads use sincKernel, built once per frame for every group
+    template <Interpolation interpolation, bool spread>
+    Lanes readDelay(int group, int frame, const float* delayValues, const DelayLine::SincKernel& sincKernel) const noexcept;
     juce::AudioProcessorValueTreeState apvts;
 
-    juce::AudioBuffer<float> delayBuffer;
-    int writePosition = 0;
-    float lfoPhase = 0.0f;
-    juce::Random rand;
-    juce::dsp::StateVariableTPTFilter<float> filter;
+    // Centre of the modulated delay and its excursion at full Amount, in ms so the
+    // effect sounds the same at any sample rate (30 and 20 samples at 44.1 kHz)
+    static constexpr float baseDelayMs = 0.68f;
+    static constexpr float depthMs = 0.45f;
+
+    DelayLine delayLine;
+    float baseDelaySamples = 0.0f;
+    float depthSamples = 0.0f;
+    juce::AudioBuffer<float> controlScratch; // per-sample mix, delay, spread and interpolator fade for one chunk
+    ChannelFrames frames;                    // the chunk's channels in SIMD lanes
+    juce::AudioBuffer<float> spreadDelays;   // per-channel delays while Spread is on
+    ChannelFrames spreadFrames;              // the same, in SIMD lanes
+    Modulator modulator;
+    NoiseTableLoader noiseTables;
+    std::atomic<juce::uint32> noiseSeed { 0 };
+    bool wasPlaying = false;
+
+    std::unique_ptr<AnalysisTap> analysisTap;
+    int analysisTapUsers = 0;             // message thread
+    std::atomic<bool> analysisEnabled { false };
+    std::atomic<int> audioThreadUsingTap { 0 };
+    juce::AudioBuffer<float> tapScratch;
+    LoadMeter loadMeter;
+    LoadGovernor loadGovernor;
+    std::atomic<bool> loadGovernorEnabled { true };
+
+    // Interpolator changes, by parameter or governor, fade over a few ms
+    static constexpr double interpolationFadeSeconds = 0.01;
+    Interpolation activeInterpolation = Interpolation::linear;
+    Interpolation fadeFrom = Interpolation::linear;
+    int fadeLength = 1;
+    int fadePosition = 1; // fadeLength once the fade is done
+    CutFilter cutFilter;
+    std::vector<CutFilter::Coefficients> cutCoefficients; // per sample of the chunk
+    OfflineWorkers offlineWorkers;
     juce::SmoothedValue<float> smoothedAmount;
 	juce::SmoothedValue<float> smoothedCut;
+    juce::SmoothedValue<float> smoothedSpread;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ErodeAudioProcessor)
 };
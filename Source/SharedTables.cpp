@@ -0,0 +1,67 @@
+#include "SharedTables.h"
+#include <map>
+
+namespace
+{
+    struct Cache
+    {
+        juce::CriticalSection lock;
+        std::map<SharedTables::Key, std::weak_ptr<const void>> tables;
+    };
+
+    Cache& getCache()
+    {
+        static Cache cache;
+        return cache;
+    }
+}
+
+namespace SharedTables
+{
+    bool Key::operator<(const Key& other) const noexcept
+    {
+        if (const int order = std::strcmp(kind, other.kind))
+            return order < 0;
+        return std::tie(size, sampleRate, variant) < std::tie(other.size, other.sampleRate, other.variant);
+    }
+
+    std::shared_ptr<const void> getOrBuild(const Key& key, const std::function<std::shared_ptr<const void>()>& build)
+    {
+        auto& cache = getCache();
+        const juce::ScopedLock sl(cache.lock);
+
+        if (auto table = cache.tables[key].lock())
+            return table;
+
+        // Tables whose last holder has gone only leave an empty entry behind
+        for (auto it = cache.tables.begin(); it != cache.tables.end();)
+            it = it->second.expired() ? cache.tables.erase(it) : std::next(it);
+
+        auto table = build();
+        cache.tables[key] = table;
+        return table;
+    }
+
+    std::shared_ptr<const void> find(const Key& key)
+    {
+        auto& cache = getCache();
+        const juce::ScopedLock sl(cache.lock);
+
+        const auto it = cache.tables.find(key);
+        return it != cache.tables.end() ? it->second.lock() : nullptr;
+    }
+
+    std::shared_ptr<const juce::dsp::FFT> getFFT(int order)
+    {
+        return get<juce::dsp::FFT>({ "fft", order }, [order] {
+            return std::make_unique<juce::dsp::FFT>(order);
+        });
+    }
+
+    std::shared_ptr<const juce::dsp::WindowingFunction<float>> getHannWindow(int size)
+    {
+        return get<juce::dsp::WindowingFunction<float>>({ "hann", size }, [size] {
+            return std::make_unique<juce::dsp::WindowingFunction<float>>(static_cast<size_t>(size), juce::dsp::WindowingFunction<float>::hann);
+        });
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Process-wide cache of read-only DSP tables, shared by every Erode instance in
+// the host. A table is built the first time it is asked for and freed when the
+// last holder lets go, so a session with 150 instances keeps one FFT plan or
+// window per size instead of 150. Lookups take a lock and may build, so fetch
+// tables while preparing and keep the pointer, never per block.
+namespace SharedTables
+{
+    struct Key
+    {
+        const char* kind;       // names the table and its type, e.g. "hann"
+        int size = 0;
+        double sampleRate = 0.0; // 0 when the contents don't depend on it
+        int variant = 0;         // anything else the contents depend on
+
+        bool operator<(const Key& other) const noexcept;
+    };
+
+    // The table held under key, or a new one from build() if nobody holds it.
+    // Every request for a kind must use the same Table type.
+    template <typename Table, typename Builder>
+    std::shared_ptr<const Table> get(const Key& key, Builder&& build)
+    {
+        auto table = getOrBuild(key, [&build]() -> std::shared_ptr<const void> {
+            return std::shared_ptr<const Table>(build());
+        });
+        return std::static_pointer_cast<const Table>(table);
+    }
+
+    std::shared_ptr<const void> getOrBuild(const Key& key, const std::function<std::shared_ptr<const void>()>& build);
+
+    // The table held under key, or nullptr. For tables too slow to build under the
+    // cache's lock: find, build outside it, then get() with the result.
+    std::shared_ptr<const void> find(const Key& key);
+
+    template <typename Table>
+    std::shared_ptr<const Table> find(const Key& key)
+    {
+        return std::static_pointer_cast<const Table>(find(key));
+    }
+
+    // FFT plans are shared between instances, so all users must transform on one
+    // thread (the analysis worker): some FFT engines keep scratch space in the plan.
+    std::shared_ptr<const juce::dsp::FFT> getFFT(int order);
+
+    // Hann window normalised like juce::dsp::WindowingFunction's default
+    std::shared_ptr<const juce::dsp::WindowingFunction<float>> getHannWindow(int size);
+}
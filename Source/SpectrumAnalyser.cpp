@@ -0,0 +1,302 @@
+#include "SpectrumAnalyser.h"
+#include "TraceEvents.h"
+
+SpectrumAnalyser::SpectrumAnalyser(AnalysisTap& t, double initialSampleRate, Resolution initialResolution,
+                                   std::function<void()> frameReadyCallback) :
+    tap(t),
+    onFrameReady(std::move(frameReadyCallback)),
+    pendingResolution(static_cast<int>(initialResolution)),
+    pendingSampleRate(initialSampleRate),
+    inScratch(4096, 0.0f),
+    outScratch(4096, 0.0f),
+    fftData(maxFFTSize * 2, 0.0f),
+    binMagnitudes(maxFFTSize / 2 + 1, 0.0f),
+    inTarget(numPoints, 0.0f),
+    outTarget(numPoints, 0.0f),
+    inWorking(numPoints, 0.0f),
+    outWorking(numPoints, 0.0f),
+    inPublished(numPoints, 0.0f),
+    outPublished(numPoints, 0.0f)
+{
+    const double wholeRange = std::numeric_limits<double>::infinity();
+    layouts[static_cast<size_t>(Resolution::fast)].push_back(std::make_unique<Band>(10, wholeRange, 1, 0));
+    layouts[static_cast<size_t>(Resolution::standard)].push_back(std::make_unique<Band>(11, wholeRange, 1, 0));
+
+    // Top first. 43 Hz bins above 1.2 kHz, about 11 Hz down to 300 Hz and 2.7 Hz
+    // below that at 44.1 kHz; the two low bands alternate so a frame runs two FFTs.
+    auto& multi = layouts[static_cast<size_t>(Resolution::multi)];
+    multi.push_back(std::make_unique<Band>(10, wholeRange, 1, 0));
+    multi.push_back(std::make_unique<Band>(10, 1200.0, 2, 1));
+    multi.push_back(std::make_unique<Band>(10, 300.0, 4, 0));
+
+    worker->add(this);
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    worker->remove(this);
+}
+
+SpectrumAnalyser::Band::Band(int order, double topFrequency, int periodToUse, int phaseToUse) :
+    fftSize(1 << order),
+    top(topFrequency),
+    period(periodToUse),
+    phase(phaseToUse),
+    fft(SharedTables::getFFT(order)),
+    window(SharedTables::getHannWindow(fftSize))
+{
+    in.samples.resize(static_cast<size_t>(fftSize), 0.0f);
+    out.samples.resize(static_cast<size_t>(fftSize), 0.0f);
+}
+
+SpectrumAnalyser::BinRange SpectrumAnalyser::BinRange::map(double first, double last, int numValues) noexcept
+{
+    BinRange range;
+    range.start = juce::jlimit(0, numValues, static_cast<int>(std::ceil(first)));
+    range.end = juce::jlimit(0, numValues, static_cast<int>(std::ceil(last)));
+
+    // Fewer values than points here, interpolate between the neighbours instead
+    if (range.end <= range.start) {
+        double centre = juce::jlimit(0.0, numValues - 1.001, 0.5 * (first + last));
+        range.start = static_cast<int>(centre);
+        range.end = range.start;
+        range.fraction = static_cast<float>(centre - range.start);
+    }
+    return range;
+}
+
+float SpectrumAnalyser::BinRange::read(const float* values) const noexcept
+{
+    if (end > start)
+        return juce::FloatVectorOperations::findMaximum(values + start, end - start);
+    return values[start] + fraction * (values[start + 1] - values[start]);
+}
+
+void SpectrumAnalyser::History::write(const float* data, int numSamples) noexcept
+{
+    const int size = static_cast<int>(samples.size());
+    while (numSamples > 0) {
+        const int n = juce::jmin(numSamples, size - pos);
+        std::copy(data, data + n, samples.begin() + pos);
+        pos = (pos + n) % size;
+        data += n;
+        numSamples -= n;
+    }
+}
+
+bool SpectrumAnalyser::getLatest(std::vector<float>& inMagnitudes, std::vector<float>& outMagnitudes)
+{
+    const juce::SpinLock::ScopedLockType sl(publishLock);
+    if (!frameReady)
+        return false;
+
+    inMagnitudes = inPublished;
+    outMagnitudes = outPublished;
+    frameReady = false;
+    return true;
+}
+
+void SpectrumAnalyser::applySettings()
+{
+    const int newResolution = juce::jlimit(0, static_cast<int>(layouts.size()) - 1, pendingResolution.load());
+    double newSampleRate = pendingSampleRate.load();
+    if (newSampleRate <= 0.0)
+        newSampleRate = 44100.0; // not prepared yet, any rate draws something sensible
+
+    if (newResolution == resolution && newSampleRate == sampleRate)
+        return;
+
+    resolution = newResolution;
+    sampleRate = newSampleRate;
+    bands = &layouts[static_cast<size_t>(resolution)];
+
+    // Grid point whose centre is the first at or above a frequency
+    auto firstPointFrom = [](double hz) {
+        if (hz <= minFrequency)
+            return 0;
+        const double point = numPoints * std::log(hz / minFrequency) / std::log(maxFrequency / minFrequency) - 0.5;
+        return static_cast<int>(juce::jlimit(0.0, static_cast<double>(numPoints), std::ceil(point)));
+    };
+
+    usedStages = 0;
+    idleSamples = 0;
+    for (size_t i = 0; i < bands->size(); ++i) {
+        auto& band = *(*bands)[i];
+        const double bottom = i + 1 < bands->size() ? (*bands)[i + 1]->top : 0.0;
+
+        // Halve the rate while the band's top stays below an eighth of it
+        band.numStages = 0;
+        while (band.numStages < maxStages && sampleRate / (2 << band.numStages) >= 8.0 * band.top)
+            ++band.numStages;
+        usedStages = juce::jmax(usedStages, band.numStages);
+        idleSamples = juce::jmax(idleSamples, band.fftSize << band.numStages);
+
+        band.firstPoint = firstPointFrom(bottom);
+        band.endPoint = std::isinf(band.top) ? numPoints : firstPointFrom(band.top);
+        const double bandRate = sampleRate / (1 << band.numStages);
+        const SharedTables::Key key { "analyser points", band.fftSize, bandRate, band.firstPoint * (numPoints + 1) + band.endPoint };
+        band.points = SharedTables::get<std::vector<BinRange>>(key, [&band, bandRate] {
+            auto points = std::make_unique<std::vector<BinRange>>();
+            const double binsPerHz = band.fftSize / bandRate;
+            for (int point = band.firstPoint; point < band.endPoint; ++point)
+                points->push_back(BinRange::map(getPointFrequency(point) * binsPerHz,
+                                                getPointFrequency(point + 1) * binsPerHz,
+                                                band.fftSize / 2 + 1));
+            return points;
+        });
+
+        for (auto* history : { &band.in, &band.out }) {
+            std::fill(history->samples.begin(), history->samples.end(), 0.0f);
+            history->pos = 0;
+        }
+    }
+
+    for (auto& decimator : inDecimators)
+        decimator.reset();
+    for (auto& decimator : outDecimators)
+        decimator.reset();
+    std::fill(inTarget.begin(), inTarget.end(), 0.0f);
+    std::fill(outTarget.begin(), outTarget.end(), 0.0f);
+    std::fill(inWorking.begin(), inWorking.end(), 0.0f);
+    std::fill(outWorking.begin(), outWorking.end(), 0.0f);
+    frameCount = 0;
+    samplesSinceSignal = idleSamples;
+    idle = false;
+}
+
+void SpectrumAnalyser::process()
+{
+    applySettings();
+
+    // Drain the tap into the band histories so the FFTs always see complete frames
+    const int scratchSize = static_cast<int>(inScratch.size());
+    while (int numPulled = tap.pull(inScratch.data(), outScratch.data(), scratchSize)) {
+        auto inRange = juce::FloatVectorOperations::findMinAndMax(inScratch.data(), numPulled);
+        auto outRange = juce::FloatVectorOperations::findMinAndMax(outScratch.data(), numPulled);
+        float peak = juce::jmax(-inRange.getStart(), inRange.getEnd(), -outRange.getStart(), outRange.getEnd());
+        samplesSinceSignal = peak > floorGain ? 0 : juce::jmin(samplesSinceSignal + numPulled, idleSamples);
+
+        feed(inScratch.data(), numPulled, false);
+        feed(outScratch.data(), numPulled, true);
+    }
+
+    // Every window below the floor only lets the peak hold decay, which needs no FFT
+    const bool silent = samplesSinceSignal >= idleSamples;
+    if (silent && idle)
+        return;
+
+    if (silent) {
+        std::fill(inTarget.begin(), inTarget.end(), 0.0f);
+        std::fill(outTarget.begin(), outTarget.end(), 0.0f);
+    }
+    else {
+        for (auto& band : *bands) {
+            if (frameCount % static_cast<juce::uint32>(band->period) == static_cast<juce::uint32>(band->phase)) {
+                analyse(*band, band->out, outTarget);
+                analyse(*band, band->in, inTarget);
+            }
+        }
+    }
+    ++frameCount;
+
+    // Peak hold smoothing, bands that skipped this frame hold their last analysis
+    juce::FloatVectorOperations::multiply(outWorking.data(), 0.97f, numPoints);
+    juce::FloatVectorOperations::max(outWorking.data(), outWorking.data(), outTarget.data(), numPoints);
+    juce::FloatVectorOperations::multiply(inWorking.data(), 0.97f, numPoints);
+    juce::FloatVectorOperations::max(inWorking.data(), inWorking.data(), inTarget.data(), numPoints);
+    idle = silent && hasDecayed(outWorking) && hasDecayed(inWorking);
+
+    {
+        const juce::SpinLock::ScopedLockType sl(publishLock);
+        std::copy(inWorking.begin(), inWorking.end(), inPublished.begin());
+        std::copy(outWorking.begin(), outWorking.end(), outPublished.begin());
+        frameReady = true;
+    }
+
+    if (onFrameReady)
+        onFrameReady();
+}
+
+void SpectrumAnalyser::feed(float* samples, int numSamples, bool wet)
+{
+    auto& decimators = wet ? outDecimators : inDecimators;
+
+    // Each stage halves the rate in place, bands pick the signal up at their stage
+    for (int stage = 0;; ++stage) {
+        for (auto& band : *bands)
+            if (band->numStages == stage)
+                (wet ? band->out : band->in).write(samples, numSamples);
+
+        if (stage == usedStages)
+            break;
+        numSamples = decimators[static_cast<size_t>(stage)].process(samples, numSamples, samples);
+    }
+}
+
+void SpectrumAnalyser::analyse(Band& band, const History& history, std::vector<float>& target)
+{
+    ERODE_TRACE_SCOPE("fft");
+    const int size = band.fftSize;
+
+    // Oldest sample first
+    std::fill(fftData.begin(), fftData.begin() + 2 * size, 0.0f);
+    std::copy(history.samples.begin() + history.pos, history.samples.end(), fftData.begin());
+    std::copy(history.samples.begin(), history.samples.begin() + history.pos, fftData.begin() + (size - history.pos));
+    band.window->multiplyWithWindowingTable(fftData.data(), static_cast<size_t>(size));
+
+    band.fft->performRealOnlyForwardTransform(fftData.data(), true);
+
+    // Sine-amplitude calibration (the window's gain is folded into the table), so a
+    // tone reads the same in every band and every resolution
+    const float scale = 1.0f / static_cast<float>(size);
+    for (int i = 0; i <= size / 2; ++i) {
+        float re = fftData[static_cast<size_t>(2 * i)];
+        float im = fftData[static_cast<size_t>(2 * i + 1)];
+        binMagnitudes[static_cast<size_t>(i)] = std::sqrt(re * re + im * im) * scale;
+    }
+
+    const auto& points = *band.points;
+    for (int point = band.firstPoint; point < band.endPoint; ++point)
+        target[static_cast<size_t>(point)] = points[static_cast<size_t>(point - band.firstPoint)].read(binMagnitudes.data());
+}
+
+bool SpectrumAnalyser::hasDecayed(const std::vector<float>& magnitudes) const
+{
+    return juce::FloatVectorOperations::findMaximum(magnitudes.data(), static_cast<int>(magnitudes.size())) < floorGain;
+}
+
+//==============================================================================
+AnalysisWorker::AnalysisWorker() : juce::Thread("Erode analysis")
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+AnalysisWorker::~AnalysisWorker()
+{
+    stopThread(1000);
+}
+
+void AnalysisWorker::add(SpectrumAnalyser* analyser)
+{
+    const juce::ScopedLock sl(lock);
+    analysers.addIfNotAlreadyThere(analyser);
+}
+
+void AnalysisWorker::remove(SpectrumAnalyser* analyser)
+{
+    const juce::ScopedLock sl(lock);
+    analysers.removeFirstMatchingValue(analyser);
+}
+
+void AnalysisWorker::run()
+{
+    ERODE_TRACE_THREAD("Analysis");
+    while (!threadShouldExit()) {
+        {
+            const juce::ScopedLock sl(lock);
+            for (auto* analyser : analysers)
+                analyser->process();
+        }
+        wait(1000 / framesPerSecond);
+    }
+}
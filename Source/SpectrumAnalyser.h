@@ -0,0 +1,153 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AnalysisTap.h"
+#include "HalfbandDecimator.h"
+#include "SharedTables.h"
+
+class AnalysisWorker;
+
+// Spectrum analysis for one display. The FFTs run on a low-priority worker
+// thread shared by every Erode instance in the process; the message thread
+// only picks up finished magnitude arrays.
+//
+// Magnitudes are published on a fixed log-spaced grid from 20 Hz to 20 kHz, so
+// every resolution looks the same to the display. Multi-resolution stitches three
+// 1024-point FFTs: one at the full rate for the top, and two on half-band
+// decimated copies of the signal for the low mids and the bass, which take turns
+// on alternate frames. No frame costs more than a single 2048-point FFT per signal.
+class SpectrumAnalyser
+{
+public:
+    enum class Resolution { fast, standard, multi };
+
+    // onFrameReady is called on the worker thread whenever a new frame has been
+    // published. It is fixed here because the worker may run as soon as this returns.
+    // Once the input has been below the display floor long enough for the curves to
+    // fall off the bottom, no more frames are published until signal returns.
+    SpectrumAnalyser(AnalysisTap& tap, double sampleRate, Resolution resolution, std::function<void()> onFrameReady);
+    ~SpectrumAnalyser();
+
+    static constexpr int numPoints = 1024;
+    static constexpr double minFrequency = 20.0, maxFrequency = 20000.0;
+
+    // Lower edge of a grid point, points run up to numPoints
+    static double getPointFrequency(double point)
+    {
+        return minFrequency * std::pow(maxFrequency / minFrequency, point / numPoints);
+    }
+
+    // Any thread, applied by the worker before its next frame
+    void setResolution(Resolution newResolution) { pendingResolution = static_cast<int>(newResolution); }
+    void setSampleRate(double newSampleRate) { pendingSampleRate = newSampleRate; }
+
+    // Values drawn into one output point: the loudest of [start, end), or when the
+    // point falls between two values, start interpolated towards start + 1
+    struct BinRange
+    {
+        int start = 0;
+        int end = 0;
+        float fraction = 0.0f;
+
+        // Covers positions [first, last) of an array of numValues
+        static BinRange map(double first, double last, int numValues) noexcept;
+        float read(const float* values) const noexcept;
+    };
+
+    // Message thread. Copies the latest dry (input) and wet (output) magnitudes,
+    // returns false if nothing new was published since the last call. Magnitudes are
+    // normalised by the FFT size, so a steady tone reads the same in every band;
+    // broadband noise reads 3 dB lower per halving in the decimated bands, whose
+    // bins are narrower.
+    bool getLatest(std::vector<float>& inMagnitudes, std::vector<float>& outMagnitudes);
+
+private:
+    friend class AnalysisWorker;
+    void process(); // worker thread
+
+    struct History
+    {
+        std::vector<float> samples;
+        int pos = 0; // oldest sample, overwritten next
+
+        void write(const float* data, int numSamples) noexcept;
+    };
+
+    // One FFT size running at sampleRate / 2^numStages over part of the grid
+    struct Band
+    {
+        Band(int order, double topFrequency, int periodToUse, int phaseToUse);
+
+        const int fftSize;
+        const double top;        // highest frequency it is used for, infinite for the top band
+        const int period, phase; // analysed on frames where frameCount % period == phase
+        const std::shared_ptr<const juce::dsp::FFT> fft;
+        const std::shared_ptr<const juce::dsp::WindowingFunction<float>> window;
+
+        int numStages = 0;
+        int firstPoint = 0, endPoint = 0;
+        std::shared_ptr<const std::vector<BinRange>> points; // indexed from firstPoint, shared per sample rate
+        History in, out;
+    };
+
+    static constexpr int maxStages = 6;
+    static constexpr int maxFFTSize = 2048;
+
+    void applySettings();
+    void feed(float* samples, int numSamples, bool wet);
+    void analyse(Band& band, const History& history, std::vector<float>& target);
+    bool hasDecayed(const std::vector<float>& magnitudes) const;
+
+    // Matches the bottom of the display: -120 dB
+    static constexpr float floorGain = 1.0e-6f;
+
+    AnalysisTap& tap;
+    const std::function<void()> onFrameReady;
+    std::atomic<int> pendingResolution;
+    std::atomic<double> pendingSampleRate;
+
+    // Worker state. Every layout is built up front, switching only remaps the grid.
+    // FFT plans, windows and grid maps come from SharedTables.
+    std::array<std::vector<std::unique_ptr<Band>>, 3> layouts;
+    std::vector<std::unique_ptr<Band>>* bands = nullptr;
+    int resolution = -1;
+    double sampleRate = 0.0;
+    int usedStages = 0;
+    int idleSamples = 0; // longest window, in input samples
+    std::array<HalfbandDecimator, maxStages> inDecimators, outDecimators;
+    std::vector<float> inScratch, outScratch;
+    juce::uint32 frameCount = 0;
+    int samplesSinceSignal = 0;
+    bool idle = false;
+    std::vector<float> fftData, binMagnitudes;
+    std::vector<float> inTarget, outTarget;   // latest analysis of every point
+    std::vector<float> inWorking, outWorking; // with peak hold
+
+    // Handed over to the message thread
+    juce::SpinLock publishLock;
+    std::vector<float> inPublished, outPublished;
+    bool frameReady = false;
+
+    juce::SharedResourcePointer<AnalysisWorker> worker;
+
+    JUCE_DECLARE_NON_COPYABLE(SpectrumAnalyser)
+};
+
+// One background thread serving every registered analyser at the display rate
+class AnalysisWorker : private juce::Thread
+{
+public:
+    AnalysisWorker();
+    ~AnalysisWorker() override;
+
+    void add(SpectrumAnalyser* analyser);
+    // Blocks until the analyser is no longer being processed
+    void remove(SpectrumAnalyser* analyser);
+
+private:
+    void run() override;
+
+    static constexpr int framesPerSecond = 60;
+
+    juce::CriticalSection lock;
+    juce::Array<SpectrumAnalyser*> analysers;
+};
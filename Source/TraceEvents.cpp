@@ -0,0 +1,120 @@
+#include "TraceEvents.h"
+
+#if ERODE_TRACE
+
+namespace
+{
+    struct Event
+    {
+        const char* name = nullptr;
+        juce::int64 start = 0;
+        int thread = 0;
+        std::atomic<juce::int64> end { 0 }; // set last, so a zero means still being written
+    };
+
+    constexpr int capacity = 1 << 18;
+    constexpr int maxThreads = 64;
+
+    // Reserved at static initialisation, so recording never allocates
+    struct Recorder
+    {
+        std::unique_ptr<Event[]> events { new Event[capacity] };
+        std::atomic<int> next { 0 };
+        std::atomic<int> dropped { 0 };
+        std::atomic<int> numThreads { 0 };
+        std::array<std::atomic<const char*>, maxThreads> threadNames {};
+    };
+
+    Recorder recorder;
+    thread_local int threadIndex = -1;
+
+    int getThreadIndex() noexcept
+    {
+        if (threadIndex < 0)
+            threadIndex = recorder.numThreads.fetch_add(1) % maxThreads;
+        return threadIndex;
+    }
+}
+
+namespace TraceEvents
+{
+    void record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept
+    {
+        const int index = recorder.next.fetch_add(1, std::memory_order_relaxed);
+        if (index >= capacity) {
+            recorder.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto& event = recorder.events[static_cast<size_t>(index)];
+        event.name = name;
+        event.start = startTicks;
+        event.thread = getThreadIndex();
+        event.end.store(juce::jmax(endTicks, startTicks + 1), std::memory_order_release);
+    }
+
+    void setThreadName(const char* name) noexcept
+    {
+        recorder.threadNames[static_cast<size_t>(getThreadIndex())].store(name, std::memory_order_relaxed);
+    }
+
+    bool writeToFile(const juce::File& file)
+    {
+        const int count = juce::jmin(recorder.next.load(), capacity);
+        const double microsPerTick = 1.0e6 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+
+        // Timestamps start at the first recorded event
+        juce::int64 origin = std::numeric_limits<juce::int64>::max();
+        for (int i = 0; i < count; ++i)
+            if (recorder.events[static_cast<size_t>(i)].end.load(std::memory_order_acquire) != 0)
+                origin = juce::jmin(origin, recorder.events[static_cast<size_t>(i)].start);
+
+        file.deleteFile();
+        juce::FileOutputStream out(file);
+        if (!out.openedOk())
+            return false;
+
+        out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":" << recorder.dropped.load() << "},\"traceEvents\":[\n";
+
+        bool first = true;
+        auto separate = [&out, &first] {
+            out << (first ? "" : ",\n");
+            first = false;
+        };
+
+        const int numThreads = juce::jmin(recorder.numThreads.load(), maxThreads);
+        for (int thread = 0; thread < numThreads; ++thread) {
+            if (auto* name = recorder.threadNames[static_cast<size_t>(thread)].load()) {
+                separate();
+                out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+                    << ",\"args\":{\"name\":\"" << name << "\"}}";
+            }
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const auto& event = recorder.events[static_cast<size_t>(i)];
+            const auto end = event.end.load(std::memory_order_acquire);
+            if (end == 0)
+                continue;
+
+            separate();
+            out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"ts\":" << juce::String(static_cast<double>(event.start - origin) * microsPerTick, 3)
+                << ",\"dur\":" << juce::String(static_cast<double>(end - event.start) * microsPerTick, 3) << "}";
+        }
+
+        out << "\n]}\n";
+        out.flush();
+        return out.getStatus().wasOk();
+    }
+
+    juce::File getDefaultFile()
+    {
+        const auto path = juce::SystemStats::getEnvironmentVariable("ERODE_TRACE_FILE", {});
+        if (path.isNotEmpty())
+            return juce::File::getCurrentWorkingDirectory().getChildFile(path);
+        return juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("Erode-trace.json");
+    }
+}
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Optional timing markers for the audio and UI hot paths, written out as Chrome
+// trace JSON that Perfetto (ui.perfetto.dev) and chrome://tracing open directly.
+// Build with ERODE_TRACE=1 to enable them; otherwise every marker compiles to
+// nothing.
+//
+//   ERODE_TRACE_SCOPE("fft");       // one slice from here to the end of the scope
+//   ERODE_TRACE_THREAD("Audio");    // names the calling thread's track
+//
+// Recording is lock-free and allocation-free: events go into a fixed buffer
+// reserved at startup, and once it is full later events are counted and dropped.
+#ifndef ERODE_TRACE
+ #define ERODE_TRACE 0
+#endif
+
+#if ERODE_TRACE
+
+namespace TraceEvents
+{
+    void record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+    void setThreadName(const char* name) noexcept;
+
+    // Writes everything recorded so far, best called once the traced threads are quiet
+    bool writeToFile(const juce::File& file);
+
+    // ERODE_TRACE_FILE if set, else Erode-trace.json in the temp folder
+    juce::File getDefaultFile();
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* nameToUse) noexcept : name(nameToUse), start(juce::Time::getHighResolutionTicks()) {}
+        ~Scope() { record(name, start, juce::Time::getHighResolutionTicks()); }
+
+    private:
+        const char* name; // a string literal, only the pointer is stored
+        const juce::int64 start;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+}
+
+ #define ERODE_TRACE_SCOPE(name) const TraceEvents::Scope JUCE_JOIN_MACRO(traceScope, __LINE__) (name)
+ #define ERODE_TRACE_THREAD(name) TraceEvents::setThreadName(name)
+
+#else
+
+ #define ERODE_TRACE_SCOPE(name)
+ #define ERODE_TRACE_THREAD(name)
+
+#endif